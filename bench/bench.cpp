@@ -0,0 +1,271 @@
+// Benchmark of every z-buffer method across meshes, resolutions and camera
+// distances. Results go to stdout (or --out) as JSON; renderer logging is muted
+// while timing. Stage times are summarized over the timed runs; each result also
+// carries the pipeline counters (FrameStats) of one extra, untimed frame rendered
+// with the detailed counters on.
+//
+// Usage: bench [--assets DIR] [--runs N] [--warmup N] [--out FILE] [--quick]
+
+#include "model.h"
+#include "renderer.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef BENCH_ASSET_DIR
+#define BENCH_ASSET_DIR "."
+#endif
+
+struct BenchMesh {
+    std::string name;
+    Model model;
+};
+
+struct BenchMethod {
+    const char* name;
+    Renderer::ZBufferMethod method;
+};
+
+struct Sample {
+    double median;
+    double p95;
+};
+
+static Sample summarize(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    Sample s;
+    s.median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    // nearest-rank percentile
+    s.p95 = times[std::min(n - 1, size_t(std::ceil(0.95 * n)) - 1)];
+    return s;
+}
+
+// UV sphere with 2 * segments * (rings - 1) triangles
+static void makeSphere(Model& model, int segments, int rings) {
+    for (int r = 0; r <= rings; r++) {
+        float theta = float(M_PI) * r / rings;
+        for (int s = 0; s < segments; s++) {
+            float phi = 2.0f * float(M_PI) * s / segments;
+            model.vertices.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        }
+    }
+    auto index = [segments](int r, int s) { return r * segments + s % segments; };
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            int quad[4] = { index(r, s), index(r + 1, s), index(r + 1, s + 1), index(r, s + 1) };
+            for (int t = 0; t < 2; t++) {
+                // the two pole rows only need one triangle per segment
+                if ((r == 0 && t == 1) || (r == rings - 1 && t == 0)) {
+                    continue;
+                }
+                Face face;
+                const int corner[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+                for (int k = 0; k < 3; k++) {
+                    face.vertices[k] = { quad[corner[t][k]], 0, 0 };
+                }
+                model.faces.push_back(face);
+            }
+        }
+    }
+}
+
+// Stack of wavy sheets facing the camera, for high depth complexity
+static void makeLayers(Model& model, int layers, int resolution) {
+    for (int l = 0; l < layers; l++) {
+        int base = model.vertices.size();
+        float z = -1.0f + 2.0f * l / std::max(1, layers - 1);
+        for (int j = 0; j <= resolution; j++) {
+            for (int i = 0; i <= resolution; i++) {
+                float x = -1.0f + 2.0f * i / resolution;
+                float y = -1.0f + 2.0f * j / resolution;
+                model.vertices.emplace_back(x, y, z + 0.05f * std::sin(6.0f * x + l) * std::cos(6.0f * y));
+            }
+        }
+        for (int j = 0; j < resolution; j++) {
+            for (int i = 0; i < resolution; i++) {
+                int v00 = base + j * (resolution + 1) + i;
+                int v10 = v00 + 1;
+                int v01 = v00 + resolution + 1;
+                int v11 = v01 + 1;
+                Face a, b;
+                a.vertices = { { { v00, 0, 0 }, { v10, 0, 0 }, { v11, 0, 0 } } };
+                b.vertices = { { { v00, 0, 0 }, { v11, 0, 0 }, { v01, 0, 0 } } };
+                model.faces.push_back(a);
+                model.faces.push_back(b);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string assetDir = BENCH_ASSET_DIR;
+    std::string outFile;
+    int runs = 5;
+    int warmup = 1;
+    bool quick = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--assets" && i + 1 < argc) {
+            assetDir = argv[++i];
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            warmup = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outFile = argv[++i];
+        } else if (arg == "--quick") {
+            quick = true;
+        } else {
+            std::cerr << "Usage: bench [--assets DIR] [--runs N] [--warmup N] [--out FILE] [--quick]" << std::endl;
+            return 1;
+        }
+    }
+
+    const BenchMethod methods[] = {
+        { "simple", Renderer::ZBufferMethod::Simple },
+        { "scanline", Renderer::ZBufferMethod::ScanLine },
+        { "interval", Renderer::ZBufferMethod::IntervalScanLine },
+        { "hierarchical", Renderer::ZBufferMethod::SimpleHierarchical },
+        { "octree", Renderer::ZBufferMethod::OctreeHierarchical },
+        { "visibility", Renderer::ZBufferMethod::VisibilityBuffer },
+    };
+    std::vector<std::pair<int, int>> resolutions = { { 640, 480 }, { 1280, 960 }, { 2400, 1800 } };
+    std::vector<float> distances = { 2.5f, 4.5f, 8.0f };
+    if (quick) {
+        resolutions = { { 640, 480 } };
+        distances = { 4.5f };
+        runs = std::min(runs, 2);
+    }
+
+    // Renderer and loader logging would swamp the report, so mute it while working
+    std::ostringstream muted;
+    std::streambuf* coutBuf = std::cout.rdbuf(muted.rdbuf());
+    std::streambuf* cerrBuf = std::cerr.rdbuf(muted.rdbuf());
+
+    std::vector<BenchMesh> meshes;
+    std::vector<double> loadTimes;
+    for (const char* name : { "bunny.obj", "teapot.obj", "cube.obj" }) {
+        BenchMesh mesh;
+        mesh.name = name;
+        Timer timer;
+        timer.start();
+        bool loaded = mesh.model.loadFromOBJ(assetDir + "/" + name);
+        if (loaded) {
+            mesh.model.normalizeToUnitCube();
+        }
+        timer.stop();
+        if (!loaded) {
+            std::cerr.rdbuf(cerrBuf);
+            std::cerr << "Skipping missing mesh " << assetDir << "/" << name << std::endl;
+            std::cerr.rdbuf(muted.rdbuf());
+            continue;
+        }
+        loadTimes.push_back(timer.elapsed());
+        meshes.push_back(std::move(mesh));
+    }
+    for (int synthetic = 0; synthetic < 2; synthetic++) {
+        BenchMesh mesh;
+        Timer timer;
+        timer.start();
+        if (synthetic == 0) {
+            mesh.name = "synthetic_sphere_250k";
+            makeSphere(mesh.model, 500, 251);
+        } else {
+            mesh.name = "synthetic_layers_16x90";
+            makeLayers(mesh.model, 16, 90);
+        }
+        mesh.model.normalizeToUnitCube();
+        timer.stop();
+        loadTimes.push_back(timer.elapsed());
+        meshes.push_back(std::move(mesh));
+    }
+
+    Light light(Vec3f(-1.0f, -1.0f, -1.0f), Vec3f(1.0f, 1.0f, 1.0f));
+    Shader shader(light, Vec3f(0.1f, 0.1f, 0.1f), Vec3f(0.5f, 0.5f, 0.5f), Vec3f(0.7f, 0.7f, 0.7f), 16.0f);
+    const Vec3f viewDir = Vec3f(1.5f, 2.5f, 3.5f).normalized();
+
+    std::ostringstream json;
+    json << "{\n  \"runs\": " << runs << ",\n  \"warmup\": " << warmup << ",\n  \"results\": [";
+    bool first = true;
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const Model& model = meshes[m].model;
+        for (const BenchMethod& method : methods) {
+            for (const auto& resolution : resolutions) {
+                int width = resolution.first, height = resolution.second;
+                for (float distance : distances) {
+                    Camera camera(model.center + viewDir * distance, model.center, Vec3f(0.0f, 1.0f, 0.0f),
+                                  60.0f, float(width) / height, 0.1f, 100.0f);
+                    Renderer renderer(width, height, shader, camera, method.method);
+
+                    std::vector<double> clearTimes, renderTimes;
+                    std::vector<double> stageTimes[StageCount];
+                    for (int run = 0; run < warmup + runs; run++) {
+                        Timer clearTimer, renderTimer;
+                        clearTimer.start();
+                        renderer.framebuffer->clear(Color(0.1, 0.1, 0.1));
+                        clearTimer.stop();
+                        renderTimer.start();
+                        renderer.render(model);
+                        renderTimer.stop();
+                        if (run >= warmup) {
+                            clearTimes.push_back(clearTimer.elapsed());
+                            renderTimes.push_back(renderTimer.elapsed());
+                            for (int stage = 0; stage < StageCount; stage++) {
+                                stageTimes[stage].push_back(renderer.frameStats.stageSeconds[stage]);
+                            }
+                        }
+                    }
+                    // One more frame with the detailed counters on, kept out of the timings
+                    renderer.collectStats = true;
+                    renderer.framebuffer->clear(Color(0.1, 0.1, 0.1));
+                    renderer.render(model);
+                    renderer.collectStats = false;
+                    muted.str("");
+
+                    Sample clear = summarize(clearTimes);
+                    Sample render = summarize(renderTimes);
+                    json << (first ? "\n" : ",\n") << "    {"
+                         << "\"mesh\": \"" << meshes[m].name << "\", "
+                         << "\"method\": \"" << method.name << "\", "
+                         << "\"width\": " << width << ", \"height\": " << height << ", "
+                         << "\"distance\": " << distance << ", "
+                         << "\"triangles\": " << model.faces.size() << ", "
+                         << "\"load_s\": " << loadTimes[m] << ", "
+                         << "\"clear_s\": {\"median\": " << clear.median << ", \"p95\": " << clear.p95 << "}, "
+                         << "\"render_s\": {\"median\": " << render.median << ", \"p95\": " << render.p95 << "}, "
+                         << "\"stages_s\": {";
+                    for (int stage = 0; stage < StageCount; stage++) {
+                        Sample sample = summarize(stageTimes[stage]);
+                        json << (stage ? ", " : "") << "\"" << pipelineStageName(stage) << "\": {\"median\": " << sample.median
+                             << ", \"p95\": " << sample.p95 << "}";
+                    }
+                    json << "}, "
+                         << "\"triangles_per_s\": " << model.faces.size() / render.median << ", "
+                         << "\"pixels_per_s\": " << double(width) * height / render.median << ", "
+                         << "\"stats\": ";
+                    renderer.frameStats.writeJson(json);
+                    json << "}";
+                    first = false;
+                }
+            }
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    std::cout.rdbuf(coutBuf);
+    std::cerr.rdbuf(cerrBuf);
+    if (outFile.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream ofs(outFile);
+        ofs << json.str();
+        std::cerr << "Benchmark results written to " << outFile << std::endl;
+    }
+    return 0;
+}
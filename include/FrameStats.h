@@ -0,0 +1,76 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Per-frame pipeline statistics filled by Renderer::render(). Stage timers and
+// triangle counts are always recorded, since they cost a clock read per stage.
+// Per-row and per-fragment counters are only gathered when
+// Renderer::collectStats is set, so a normal frame does no extra work per pixel.
+
+enum PipelineStage {
+    StageLoad,       // model parsing or mapping
+    StageNormals,    // Model::computeNormals
+    StageTransform,  // vertex transform into NDC
+    StageCull,       // back-face and frustum culling
+    StageTableBuild, // scan-line edge table, or tile binning in the Simple path
+    StageScan,       // scan conversion and depth test, wall time
+    StageShade,      // fragment shading, summed over raster threads
+    StageWrite,      // image output
+    StageCount
+};
+
+const char* pipelineStageName(int stage);
+
+// Fragment counters kept privately by each raster thread and summed afterwards
+struct FragmentCounters {
+    uint64_t tested = 0;   // pixels inside a triangle or span that reached the depth test
+    uint64_t passed = 0;   // pixels that won the depth test and were written
+    double shadeSeconds = 0.0;
+
+    FragmentCounters& operator+=(const FragmentCounters& other) {
+        tested += other.tested;
+        passed += other.passed;
+        shadeSeconds += other.shadeSeconds;
+        return *this;
+    }
+};
+
+struct FrameStats {
+    uint64_t frame = 0;
+    std::string method;
+    int width = 0;
+    int height = 0;
+    bool detailed = false; // the counters below the triangle counts were gathered
+
+    double stageSeconds[StageCount] = {};
+
+    uint64_t trianglesSubmitted = 0;
+    uint64_t trianglesBackFacing = 0;
+    uint64_t trianglesOutsideFrustum = 0;
+    uint64_t trianglesOccluded = 0;   // rejected by the hierarchical z test
+    uint64_t trianglesRasterized = 0;
+
+    uint64_t scanRows = 0;            // rows scanned by the scan-line method
+    uint64_t activeEdgesTotal = 0;    // summed over those rows
+    uint64_t activeEdgesMax = 0;
+    FragmentCounters fragments;
+    uint64_t pixelsCovered = 0;       // pixels with at least one fragment written
+
+    // Clears everything but the frame number, method and size
+    void reset();
+
+    uint64_t trianglesCulled() const { return trianglesBackFacing + trianglesOutsideFrustum + trianglesOccluded; }
+    double activeEdgesMean() const { return scanRows ? double(activeEdgesTotal) / scanRows : 0.0; }
+    // Fragments written per covered pixel; 1.0 means every pixel was written once
+    double overdraw() const { return pixelsCovered ? double(fragments.passed) / pixelsCovered : 0.0; }
+
+    // One JSON object on a single line
+    void writeJson(std::ostream& os) const;
+    static void writeCsvHeader(std::ostream& os);
+    void writeCsvRow(std::ostream& os) const;
+};
+
+#endif // FRAMESTATS_H
@@ -0,0 +1,47 @@
+#ifndef HIERARCHICALZBUFFER_H
+#define HIERARCHICALZBUFFER_H
+
+#include "framebuffer.h"
+#include <vector>
+
+// Hierarchical z-buffer: a depth pyramid built on top of SimpleZbuffer::depthBuffer.
+// Depth follows the SimpleZbuffer convention (larger NDC z is nearer, cleared to -inf),
+// so every pyramid texel stores the farthest, i.e. smallest, depth of the 2x2 texels
+// below it. A primitive is hidden over a region when its nearest depth is still
+// farther than the farthest depth already stored there.
+
+struct DepthLevel
+{
+	int width, height;
+	std::vector<float> depth;
+};
+
+class HierarchicalZbuffer : public SimpleZbuffer
+{
+public:
+	HierarchicalZbuffer() = delete;
+	HierarchicalZbuffer(int w, int h, DepthFormat format = DepthFloat32);
+	~HierarchicalZbuffer() = default;
+
+	// depthPyramid[0] is half the resolution of depthBuffer, the last level is 1x1.
+	std::vector<DepthLevel> depthPyramid;
+
+	// Screen rect touched by depth writes since the last updatePyramid().
+	int dirtyX0, dirtyY0, dirtyX1, dirtyY1;
+
+	virtual void clear(const Color& clearColor = Color(0, 0, 0));
+	// SimpleZbuffer::writeSpan that also extends the dirty rect by the written pixels.
+	void writeSpan(int x, int y, int count, uint32_t mask, const Color* colors, const float* depths);
+
+	// Propagates the dirty rect up the pyramid.
+	void updatePyramid();
+	// Conservative test of a screen rect (inclusive, clamped to the buffer) at the
+	// given nearest depth. Returns true only if every covered pixel is nearer.
+	bool isOccluded(int x0, int y0, int x1, int y1, float nearestDepth) const;
+
+private:
+	float farthestDepth(int level, int x, int y) const;
+	void resetDirty();
+};
+
+#endif // HIERARCHICALZBUFFER_H
@@ -4,6 +4,9 @@
 #include "framebuffer.h"
 #include "model.h"
 #include "objtype.h"
+#include "VertexCache.h"
+#include "scene.h"
+#include "FrameStats.h"
 
 // with reference to ppt 11 of CG course, JieQing Feng Prof. in ZJU. 
 
@@ -14,7 +17,7 @@ struct Edgef
 	float gradientDxDy, gradientDzDy;
 	Vec3f rgbStart, rgbCur, rgbEnd;
 	Vec3f gradientdRGBdy; 
-	bool isPaired; 
+	int yStart, yEnd; // active on scanlines [yStart, yEnd)
 
 	uint edgeId;
 	uint polygonId;
@@ -24,12 +27,78 @@ struct Edgef
 }; 
 
 
+// Edge ids grouped by scan line in one contiguous array (CSR layout): the ids of
+// line y are ids[offsets[y]] .. ids[offsets[y + 1] - 1], in edge id order.
+struct EdgeBuckets
+{
+	std::vector<uint> offsets; // lines + 1 entries
+	std::vector<uint> ids;
+
+	// Counts edges per line, prefix-sums the counts and scatters the ids.
+	void build(const std::vector<Edgef>& edges, int lines, int Edgef::*line);
+
+	uint count(int line) const { return offsets[line + 1] - offsets[line]; }
+	const uint* begin(int line) const { return ids.data() + offsets[line]; }
+	const uint* end(int line) const { return ids.data() + offsets[line + 1]; }
+
+private:
+	std::vector<uint> cursor; // scratch: next free slot per line while scattering
+};
+
+
+// Screen-space plane a*x + b*y + c*z + d = 0 of a polygon, with x and y in pixels
+// and z the NDC depth. Used by the interval scan to compare polygons anywhere on
+// a line without walking their edges.
 struct Polygonf
 {
-	std::vector<Vertex> vertices;
 	float a, b, c, d; 
 	int polygonId; 
-	int dy; 
+	int dy; // scan lines crossed by the polygon's edges
+
+	float depthAt(float x, float y) const { return -(a * x + b * y + d) / c; }
+};
+
+
+// Pixels [x0, x1] of one polygon on the current line, with its edge-interpolated color
+struct LineSpan
+{
+	uint polygonId;
+	int x0, x1;
+	float xLeft;     // left edge crossing, where rgbLeft applies
+	Vec3f rgbLeft;
+	Vec3f gradientdRGBdx;
+};
+
+// A span entering (at x0) or leaving (after x1) the set of spans covering a pixel
+struct SpanEvent
+{
+	int x;
+	uint span;       // index into ScanBand::spans
+	bool enter;
+};
+
+
+// Scan state for one contiguous band of rows [yBegin, yEnd). Bands run on their
+// own threads, so each keeps private copies of the edges it advances.
+struct ScanBand
+{
+	int yBegin, yEnd;
+	std::vector<float> zBufferLine;
+	std::vector<Edgef> edges;              // band-local edge copies, cur is advanced per line
+	std::vector<uint> activeEdgeTable;     // indices into edges, sorted by cur.x
+	std::vector<uint> enteringEdges;       // scratch: edges entering on the current line
+	std::vector<uint> mergedEdges;         // scratch: merge target, swapped with activeEdgeTable
+	std::vector<int> polygonPendingEdge;   // per polygon, left edge waiting for its pair or -1
+	// Interval scan scratch, rebuilt per line
+	std::vector<LineSpan> spans;
+	std::vector<SpanEvent> spanEvents;     // sorted by x
+	std::vector<uint> coveringSpans;       // spans covering the current interval
+
+	// Filled only when ScanLineZBuffer::countStats is set
+	uint64_t activeEdgesTotal = 0;
+	uint64_t activeEdgesMax = 0;
+	uint64_t pixelsCovered = 0;
+	FragmentCounters fragments;
 };
 
 
@@ -42,21 +111,43 @@ public:
 	ScanLineZBuffer(int w, int h);
 	~ScanLineZBuffer() = default;
 	void clear();
-	void buildTable(const Model& model);
-	void actScan(const Model& model); 
+	// Builds the edge tables for the given scene-wide faces from positions
+	// already transformed into the cache. Polygon ids are the face ids offset by
+	// curFaceOffset, so several calls can share one scan.
+	void buildTable(const Scene& scene, const VertexCache& cache, const std::vector<uint>& faceIds);
+	void actScan();
 
 	int curFaceOffset = 0;
 	int edgeIdOffset = 0;
-	
-	std::vector<float> zBufferLine;
 
-	std::vector<Edgef> edgeTable;
-	std::vector<Edgef> activeEdgeTable;
-	std::vector<std::vector<int>> activeEdgeIdTable;   // enter by line
-	std::vector<std::vector<int>> deactiveEdgeIdTable; // escape by line
+	// Threads used by actScan, each owning one row band; 1 scans serially.
+	int scanThreads;
 
+	// Gather per-row and per-fragment counters into the bands during actScan
+	bool countStats = false;
+	// Resolve visibility once per interval between edge crossings using the
+	// polygon planes, instead of depth testing every pixel
+	bool intervalScan = false;
+	// Results of the last buildTable and actScan
+	uint tableFaces = 0;        // faces that produced at least one edge
+	double tableBuildTime = 0.0;
+	double scanTime = 0.0;
 
-    virtual void setPixel(int x, int y, const Color& color, float depth);
+	std::vector<Edgef> edgeTable;
+	std::vector<Polygonf> polygonTable; // by polygon id; filled for faces with edges
+	EdgeBuckets activeEdgeIdTable;   // enter by line
+	EdgeBuckets deactiveEdgeIdTable; // escape by line
+	std::vector<ScanBand> bands;
+
+
+private:
+	void splitBands(int count);
+	void scanBand(ScanBand& band);
+	// Fills line y from the polygon spans of the sorted active edges, one
+	// visibility decision per interval of constant coverage.
+	void scanIntervals(ScanBand& band, int y);
+	// Writes pixels [x0, x1] of line y with the span's interpolated color
+	void fillSpan(const LineSpan& span, int x0, int x1, int y);
 }; 
 
 
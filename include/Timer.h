@@ -41,7 +41,7 @@ public:
     double elapsed() const {
         if (m_running) {
             auto current = Clock::now();
-            return (m_elapsed + (current - m_start)).count();
+            return Duration(m_elapsed + (current - m_start)).count();
         } else {
             return m_elapsed.count();
         }
@@ -0,0 +1,37 @@
+#ifndef VERTEXCACHE_H
+#define VERTEXCACHE_H
+
+#include "model.h"
+#include "matrix.h"
+#include "objtype.h"
+#include "scene.h"
+#include <vector>
+
+// Per-frame vertex transform stage. Every vertex of every scene instance is
+// transformed once with the instance's model-view-projection matrix and its NDC
+// position is stored as a structure of arrays, in scene-wide vertex numbering.
+// Faces index the cache through Face::VertexIndices plus the instance's
+// vertexBase, so a vertex shared by several faces is transformed only once.
+
+class VertexCache
+{
+public:
+	std::vector<float> x, y, z; // NDC position per scene vertex
+	std::vector<float> w;       // clip-space w per scene vertex, for the culler's outcodes
+
+	VertexCache() = default;
+
+	// Transforms all vertices of the scene, in blocks spread over `threads` threads.
+	void transform(const Scene& scene, const Mat4x4& viewProjection, int threads);
+	// Fills the three vertices of a face of the instance: NDC and world-space
+	// position, world-space vertex normal and texcoord.
+	void gatherFace(const SceneInstance& instance, const Face& face, Vertex* vertices) const;
+
+private:
+	// Returns the number of vertices with w == 0, which keep their model position.
+	int transformRange(const Model& model, const Mat4x4& modelViewProjection, uint base, int begin, int end);
+
+	std::vector<Mat4x4> instanceMatrices; // model-view-projection per instance, last transform()
+};
+
+#endif // VERTEXCACHE_H
@@ -0,0 +1,40 @@
+#ifndef VISIBILITYBUFFER_H
+#define VISIBILITYBUFFER_H
+
+#include "framebuffer.h"
+#include <cstdint>
+#include <vector>
+
+// Visibility buffer: rasterization keeps only the depth and the scene-wide face id
+// of the nearest triangle per pixel. Colors are filled in afterwards by a single
+// shading pass over the final ids, so each visible pixel is shaded exactly once
+// however many triangles were drawn over it. Pixels without a triangle keep the
+// clear color.
+
+class VisibilityBuffer : public SimpleZbuffer
+{
+public:
+	static constexpr uint32_t NoTriangle = ~0u;
+
+	VisibilityBuffer() = delete;
+	VisibilityBuffer(int w, int h, DepthFormat format = DepthFloat32);
+	~VisibilityBuffer() = default;
+
+	std::vector<uint32_t> triangleIds; // per pixel, NoTriangle where nothing was drawn
+
+	virtual void clear(const Color& clearColor = Color(0, 0, 0));
+	// Writes id and depths[i] to (x + i, y) for every bit i set in mask.
+	void writeIdSpan(int x, int y, int count, uint32_t mask, uint32_t id, const float* depths) {
+		mask = clipSpanMask(x, y, count, mask, width, height);
+		int rowStart = y * width + x;
+		for (; mask; mask &= mask - 1) {
+			int i = __builtin_ctz(mask);
+			triangleIds[rowStart + i] = id;
+			storeDepth(rowStart + i, depths[i]);
+			DepthTile& tile = depthTileAt(x + i, y);
+			tile.nearest = depths[i] > tile.nearest ? depths[i] : tile.nearest;
+		}
+	}
+};
+
+#endif // VISIBILITYBUFFER_H
@@ -14,6 +14,9 @@ public:
     float aspectRatio;
     float nearPlane;
     float farPlane;
+    // Map the near plane to NDC z 1 and the far plane to 0, so float depth keeps
+    // its precision at distance. Nearer still means larger z.
+    bool reversedZ = false;
 
     Camera();
     Camera(const Vec3f& pos, const Vec3f& tgt, const Vec3f& upVec, float fieldOfView, float aspect, float nearP, float farP);
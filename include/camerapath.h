@@ -0,0 +1,36 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include "camera.h"
+#include <string>
+#include <vector>
+
+// Camera motion for multi-frame renders. An orbit turns the eye around the
+// target about the camera's up axis, one full turn over the animation. A keyframe
+// path moves eye and target linearly through a list of poses, spending the same
+// number of frames on every segment.
+class CameraPath {
+public:
+    struct Keyframe {
+        Vec3f position;
+        Vec3f target;
+    };
+
+    // Turntable around the camera's current target, starting from its position
+    static CameraPath orbit(const Camera& start);
+
+    // Text file with one "px py pz tx ty tz" keyframe per line; '#' starts a comment.
+    bool loadKeyframes(const std::string& filename);
+
+    // Moves the camera to frame `frame` of `frameCount`.
+    void apply(Camera& camera, int frame, int frameCount) const;
+
+private:
+    bool isOrbit = false;
+    Vec3f orbitCenter;
+    Vec3f orbitOffset;   // eye relative to the center at frame 0
+    Vec3f orbitAxis;
+    std::vector<Keyframe> keyframes;
+};
+
+#endif // CAMERAPATH_H
@@ -0,0 +1,70 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "model.h"
+#include "camera.h"
+#include "matrix.h"
+#include "VertexCache.h"
+#include "scene.h"
+#include <cstdint>
+#include <vector>
+
+// Triangle culling ahead of rasterization. A triangle is rejected when all three
+// vertices lie outside the same view-frustum plane, or when its screen-space
+// winding shows it facing away from the camera. Triangles with a vertex behind
+// the eye are never back-face tested, since the perspective divide flips them.
+
+enum CullMode {
+	CullNone = 0,
+	CullBackFaces = 1 << 0,
+	CullFrustum = 1 << 1,
+	CullAll = CullBackFaces | CullFrustum
+};
+
+// Outcode bits, one per frustum plane a vertex is outside of
+enum CullOutcode : uint8_t {
+	OutLeft = 1 << 0,
+	OutRight = 1 << 1,
+	OutBottom = 1 << 2,
+	OutTop = 1 << 3,
+	OutNear = 1 << 4, // also set for vertices behind the eye
+	OutFar = 1 << 5
+};
+
+struct CullStats {
+	uint submitted = 0;
+	uint backFacing = 0;
+	uint outsideFrustum = 0;
+};
+
+class Culler
+{
+public:
+	int mode = CullAll;
+
+	std::vector<uint8_t> outcodes;  // per scene vertex, for the last run()
+	std::vector<uint> visibleFaces; // scene-wide ids of the faces that survived run(), ascending
+	CullStats stats;
+
+	// Reads the near/far depth range and the facing convention from the camera.
+	void setup(const Camera& camera, const Mat4x4& projectionMatrix);
+	// Culls every face of the scene using the NDC positions and clip w in the cache.
+	void run(const Scene& scene, const VertexCache& cache, int threads);
+
+	uint8_t outcode(const Vec4f& clip) const;
+	// Same, for a point already divided by its clip w
+	uint8_t outcode(float x, float y, float z, float w) const;
+	// Returns CullNone if the triangle is kept, else the test that rejected it.
+	// Positions are NDC, outcodes as returned by outcode(). flipsWinding inverts the
+	// facing test for faces of a mirroring instance.
+	int classify(const Vec3f& p0, const Vec3f& p1, const Vec3f& p2, uint8_t code0, uint8_t code1, uint8_t code2,
+				 bool flipsWinding = false) const;
+
+private:
+	float nearDepth = 0.0f;   // NDC z of the near and far planes
+	float farDepth = 1.0f;
+	float frontW = -1.0f;     // sign of clip w for points in front of the eye
+	std::vector<uint8_t> faceResult;
+};
+
+#endif // CULLING_H
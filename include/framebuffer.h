@@ -4,8 +4,25 @@
 #include "vector.h"
 #include <vector>
 #include <cstdint>
+#include <sys/uio.h>
 #include "objtype.h"
 
+// Pixels are written in spans: one call covers up to 32 consecutive pixels of a
+// row, and bit i of the mask selects pixel x + i. The caller has already done the
+// depth test, so the mask only holds the pixels that passed. Spans are clipped to
+// the buffer once per call, not per pixel.
+inline uint32_t clipSpanMask(int x, int y, int count, uint32_t mask, int width, int height) {
+    if (y < 0 || y >= height || count <= 0)
+        return 0;
+    int begin = x < 0 ? -x : 0;
+    int end = count < width - x ? count : width - x;
+    if (begin >= end)
+        return 0;
+    uint32_t upper = end >= 32 ? ~0u : (1u << end) - 1;
+    uint32_t lower = begin >= 32 ? ~0u : (1u << begin) - 1;
+    return mask & upper & ~lower;
+}
+
 
 class Renderer; 
 
@@ -16,19 +33,104 @@ public:
     int height;
     std::vector<Color> colorBuffer;
     Framebuffer(int w, int h);
-    void clear(const Color& clearColor = Color(0, 0, 0));
+    virtual void clear(const Color& clearColor = Color(0, 0, 0));
     void saveToBMP(const std::string& filename) const;
-    virtual void setPixel(int x, int y, const Color& color, float depth) = 0; 
+    // Writes colors[i] to (x + i, y) for every bit i set in mask.
+    void writeSpan(int x, int y, int count, uint32_t mask, const Color* colors) {
+        mask = clipSpanMask(x, y, count, mask, width, height);
+        Color* row = colorBuffer.data() + y * width;
+        for (; mask; mask &= mask - 1) {
+            int i = __builtin_ctz(mask);
+            row[x + i] = colors[i];
+        }
+    }
     virtual ~Framebuffer() = default;
-    
+
+private:
+    // Scratch for saveToBMP, kept so saving every frame of an animation reuses it
+    mutable std::vector<struct iovec> bmpIov;
+};
+
+// Conservative depth range of one DepthTileSize x DepthTileSize tile of the depth
+// buffer. nearest is exact; farthest may lag behind writes until the tile is
+// refreshed, which only makes it farther than the truth.
+struct DepthTile {
+    float farthest;
+    float nearest;
+};
+
+// Storage of SimpleZbuffer depth. The fixed-point formats quantize NDC z over the
+// range set by setDepthRange: 0 is the clear value, 1 the far plane and the
+// largest value the near plane, so nearer still compares greater.
+enum DepthFormat {
+    DepthFloat32,
+    DepthUnorm16,   // 2 bytes per pixel
+    DepthUnorm24    // low 24 bits of a 32-bit word
 };
 
 class SimpleZbuffer : public Framebuffer{
 public:
+    static const int DepthTileSize = 8;
+
+    const DepthFormat depthFormat;
+    // Only the vector of depthFormat is allocated
     std::vector<float> depthBuffer;
-    SimpleZbuffer(int w, int h);
-    void clear(const Color& clearColor = Color(0, 0, 0));
-    virtual void setPixel(int x, int y, const Color& color, float depth);
+    std::vector<uint16_t> depthBuffer16;
+    std::vector<uint32_t> depthBuffer24;
+    int tilesX, tilesY;
+    std::vector<DepthTile> depthTiles; // row-major, partial tiles at the right and bottom edges
+
+    SimpleZbuffer(int w, int h, DepthFormat format = DepthFloat32);
+    virtual void clear(const Color& clearColor = Color(0, 0, 0));
+    // Writes colors[i] and depths[i] to (x + i, y) for every bit i set in mask.
+    void writeSpan(int x, int y, int count, uint32_t mask, const Color* colors, const float* depths) {
+        mask = clipSpanMask(x, y, count, mask, width, height);
+        int rowStart = y * width + x;
+        for (; mask; mask &= mask - 1) {
+            int i = __builtin_ctz(mask);
+            colorBuffer[rowStart + i] = colors[i];
+            storeDepth(rowStart + i, depths[i]);
+            DepthTile& tile = depthTileAt(x + i, y);
+            tile.nearest = depths[i] > tile.nearest ? depths[i] : tile.nearest;
+        }
+    }
+
+    // NDC z of the far and near planes, mapped onto the fixed-point range
+    void setDepthRange(float farDepth, float nearDepth);
+    // Fixed-point value z is stored as; the depth test compares these directly
+    uint32_t quantizeDepth(float z) const {
+        float t = (z - depthRangeFar) * depthRangeScale;
+        t = t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f;
+        return uint32_t(t * depthQuantumCount + 0.5f) + 1;
+    }
+    float dequantizeDepth(uint32_t q) const;
+    void storeDepth(int index, float z) {
+        switch (depthFormat) {
+        case DepthFloat32: depthBuffer[index] = z; break;
+        case DepthUnorm16: depthBuffer16[index] = uint16_t(quantizeDepth(z)); break;
+        case DepthUnorm24: depthBuffer24[index] = quantizeDepth(z); break;
+        }
+    }
+    // Stored depth as NDC z, -inf where nothing was written
+    float depthAt(int index) const {
+        switch (depthFormat) {
+        case DepthUnorm16: return dequantizeDepth(depthBuffer16[index]);
+        case DepthUnorm24: return dequantizeDepth(depthBuffer24[index]);
+        default: return depthBuffer[index];
+        }
+    }
+    // Bytes of depth storage per pixel
+    int depthBytes() const { return depthFormat == DepthUnorm16 ? 2 : 4; }
+
+    float depthRangeFar = 0.0f;
+    float depthRangeScale = 1.0f;       // 1 / (near - far)
+    float depthQuantumCount = 65534.0f; // largest stored value minus one
+
+    DepthTile& depthTileAt(int x, int y) {
+        return depthTiles[(y / DepthTileSize) * tilesX + x / DepthTileSize];
+    }
+    // Recomputes the farthest depth of tile (tx, ty) from the depth buffer
+    void refreshTileFarthest(int tx, int ty);
 };
 
 #endif // FRAMEBUFFER_H
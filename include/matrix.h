@@ -3,13 +3,20 @@
 #define Mat_H
 
 #include <iostream>
+#include <iomanip>
 #include <array>
+#include <cstddef>
+#include <cmath>
 #include <stdexcept>
-#include "vector.h" 
+#include "vector.h"
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
-// Forward declarations
-class Vec3f;
-class Vec4f;
+// Header-only and trivially copyable like the vector types.
 
 // Mat3x3 Class
 class Mat3x3 {
@@ -18,39 +25,117 @@ public:
     float m[3][3];
 
     // Constructors
-    Mat3x3(); // Default constructor (Identity Mat)
-    Mat3x3(const std::array<std::array<float, 3>, 3>& elements); // Parameterized constructor
-    Mat3x3(const Mat3x3& other); // Copy constructor
-
-    // Destructor
-    ~Mat3x3();
+    // Default constructor (Identity Mat)
+    constexpr Mat3x3() : m{ { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } } {}
+    // Parameterized constructor
+    Mat3x3(const std::array<std::array<float, 3>, 3>& elements) {
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                m[i][j] = elements[i][j];
+    }
 
     // Operator Overloads
-    Mat3x3 operator+(const Mat3x3& other) const;
-    Mat3x3 operator-(const Mat3x3& other) const;
-    Mat3x3 operator*(const Mat3x3& other) const; // Mat multiplication
-    Mat3x3 operator*(float scalar) const; // Scalar multiplication
-    Vec3f operator*(const Vec3f& vec) const; // Mat-vector multiplication
+    Mat3x3 operator+(const Mat3x3& other) const {
+        Mat3x3 result;
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                result.m[i][j] = m[i][j] + other.m[i][j];
+        return result;
+    }
+    Mat3x3 operator-(const Mat3x3& other) const {
+        Mat3x3 result;
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                result.m[i][j] = m[i][j] - other.m[i][j];
+        return result;
+    }
+    // Mat multiplication
+    Mat3x3 operator*(const Mat3x3& other) const {
+        Mat3x3 result;
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                result.m[i][j] = m[i][0] * other.m[0][j] + m[i][1] * other.m[1][j] + m[i][2] * other.m[2][j];
+        return result;
+    }
+    // Scalar multiplication
+    Mat3x3 operator*(float scalar) const {
+        Mat3x3 result;
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                result.m[i][j] = m[i][j] * scalar;
+        return result;
+    }
+    // Mat-vector multiplication
+    constexpr Vec3f operator*(const Vec3f& vec) const {
+        return Vec3f(m[0][0]*vec.x + m[0][1]*vec.y + m[0][2]*vec.z,
+                     m[1][0]*vec.x + m[1][1]*vec.y + m[1][2]*vec.z,
+                     m[2][0]*vec.x + m[2][1]*vec.y + m[2][2]*vec.z);
+    }
 
-    Mat3x3& operator+=(const Mat3x3& other);
-    Mat3x3& operator-=(const Mat3x3& other);
-    Mat3x3& operator*=(const Mat3x3& other);
-    Mat3x3& operator*=(float scalar);
+    Mat3x3& operator+=(const Mat3x3& other) { return *this = *this + other; }
+    Mat3x3& operator-=(const Mat3x3& other) { return *this = *this - other; }
+    Mat3x3& operator*=(const Mat3x3& other) { return *this = *this * other; }
+    Mat3x3& operator*=(float scalar) { return *this = *this * scalar; }
 
-    bool operator==(const Mat3x3& other) const;
-    bool operator!=(const Mat3x3& other) const;
+    bool operator==(const Mat3x3& other) const {
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                if(m[i][j] != other.m[i][j])
+                    return false;
+        return true;
+    }
+    bool operator!=(const Mat3x3& other) const { return !(*this == other); }
 
     // Utility Functions
-    Mat3x3 transpose() const;
-    float determinant() const;
-    Mat3x3 inverse() const;
+    Mat3x3 transpose() const {
+        Mat3x3 transposed;
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                transposed.m[i][j] = m[j][i];
+        return transposed;
+    }
+    float determinant() const {
+        // Using Sarrus' rule
+        return m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+             - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+             + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+    }
+    Mat3x3 inverse() const {
+        float det = determinant();
+        if(det == 0.0f)
+            throw std::runtime_error("Mat3x3 is singular and cannot be inverted.");
+
+        Mat3x3 inv;
+        inv.m[0][0] = (m[1][1]*m[2][2] - m[1][2]*m[2][1]) / det;
+        inv.m[0][1] = (m[0][2]*m[2][1] - m[0][1]*m[2][2]) / det;
+        inv.m[0][2] = (m[0][1]*m[1][2] - m[0][2]*m[1][1]) / det;
+
+        inv.m[1][0] = (m[1][2]*m[2][0] - m[1][0]*m[2][2]) / det;
+        inv.m[1][1] = (m[0][0]*m[2][2] - m[0][2]*m[2][0]) / det;
+        inv.m[1][2] = (m[0][2]*m[1][0] - m[0][0]*m[1][2]) / det;
+
+        inv.m[2][0] = (m[1][0]*m[2][1] - m[1][1]*m[2][0]) / det;
+        inv.m[2][1] = (m[0][1]*m[2][0] - m[0][0]*m[2][1]) / det;
+        inv.m[2][2] = (m[0][0]*m[1][1] - m[0][1]*m[1][0]) / det;
+        return inv;
+    }
 
     // Friend Functions
-    friend std::ostream& operator<<(std::ostream& os, const Mat3x3& mat);
+    friend std::ostream& operator<<(std::ostream& os, const Mat3x3& mat) {
+        os << std::fixed << std::setprecision(2);
+        for(int i=0;i<3;i++) {
+            os << "[ ";
+            for(int j=0;j<3;j++) {
+                os << mat.m[i][j] << " ";
+            }
+            os << "]\n";
+        }
+        return os;
+    }
 };
 
 // Scalar multiplication from the left
-Mat3x3 operator*(float scalar, const Mat3x3& mat);
+inline Mat3x3 operator*(float scalar, const Mat3x3& mat) { return mat * scalar; }
 
 // Mat4x4 Class
 class Mat4x4 {
@@ -59,38 +144,207 @@ public:
     float m[4][4];
 
     // Constructors
-    Mat4x4(); // Default constructor (Identity Mat)
-    Mat4x4(const std::array<std::array<float, 4>, 4>& elements); // Parameterized constructor
-    Mat4x4(const Mat4x4& other); // Copy constructor
+    // Default constructor (zero Mat; Camera fills in only the non-zero entries)
+    constexpr Mat4x4() : m{} {}
+    // Parameterized constructor
+    Mat4x4(const std::array<std::array<float, 4>, 4>& elements) {
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                m[i][j] = elements[i][j];
+    }
 
-    // Destructor
-    ~Mat4x4();
+    // Affine transforms for placing models
+    static Mat4x4 identity() {
+        Mat4x4 result;
+        for (int i = 0; i < 4; i++)
+            result.m[i][i] = 1.0f;
+        return result;
+    }
+    static Mat4x4 translation(const Vec3f& offset) {
+        Mat4x4 result = identity();
+        result.m[0][3] = offset.x;
+        result.m[1][3] = offset.y;
+        result.m[2][3] = offset.z;
+        return result;
+    }
+    static Mat4x4 scaling(float factor) {
+        Mat4x4 result = identity();
+        for (int i = 0; i < 3; i++)
+            result.m[i][i] = factor;
+        return result;
+    }
+    static Mat4x4 rotationY(float radians) {
+        Mat4x4 result = identity();
+        float c = std::cos(radians), s = std::sin(radians);
+        result.m[0][0] = c;
+        result.m[0][2] = s;
+        result.m[2][0] = -s;
+        result.m[2][2] = c;
+        return result;
+    }
 
     // Operator Overloads
-    Mat4x4 operator+(const Mat4x4& other) const;
-    Mat4x4 operator-(const Mat4x4& other) const;
-    Mat4x4 operator*(const Mat4x4& other) const; // Mat multiplication
-    Mat4x4 operator*(float scalar) const; // Scalar multiplication
-    Vec4f operator*(const Vec4f& vec) const; // Mat-vector multiplication
+    Mat4x4 operator+(const Mat4x4& other) const {
+        Mat4x4 result;
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                result.m[i][j] = m[i][j] + other.m[i][j];
+        return result;
+    }
+    Mat4x4 operator-(const Mat4x4& other) const {
+        Mat4x4 result;
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                result.m[i][j] = m[i][j] - other.m[i][j];
+        return result;
+    }
+    // Mat multiplication
+    Mat4x4 operator*(const Mat4x4& other) const {
+        Mat4x4 result;
+        for(int i=0;i<4;i++) {
+            for(int j=0;j<4;j++) {
+                result.m[i][j] = 0.0f;
+                for(int k=0;k<4;k++) {
+                    result.m[i][j] += m[i][k] * other.m[k][j];
+                }
+            }
+        }
+        return result;
+    }
+    // Scalar multiplication
+    Mat4x4 operator*(float scalar) const {
+        Mat4x4 result;
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                result.m[i][j] = m[i][j] * scalar;
+        return result;
+    }
+    // Mat-vector multiplication
+    Vec4f operator*(const Vec4f& vec) const {
+#if defined(__SSE__)
+        // Four row products, transposed so a vertical add yields the four dot products
+        __m128 v = _mm_loadu_ps(&vec.x);
+        __m128 r0 = _mm_mul_ps(_mm_loadu_ps(m[0]), v);
+        __m128 r1 = _mm_mul_ps(_mm_loadu_ps(m[1]), v);
+        __m128 r2 = _mm_mul_ps(_mm_loadu_ps(m[2]), v);
+        __m128 r3 = _mm_mul_ps(_mm_loadu_ps(m[3]), v);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        Vec4f result;
+        _mm_storeu_ps(&result.x, _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+        return result;
+#else
+        return Vec4f(m[0][0]*vec.x + m[0][1]*vec.y + m[0][2]*vec.z + m[0][3]*vec.w,
+                     m[1][0]*vec.x + m[1][1]*vec.y + m[1][2]*vec.z + m[1][3]*vec.w,
+                     m[2][0]*vec.x + m[2][1]*vec.y + m[2][2]*vec.z + m[2][3]*vec.w,
+                     m[3][0]*vec.x + m[3][1]*vec.y + m[3][2]*vec.z + m[3][3]*vec.w);
+#endif
+    }
 
-    Mat4x4& operator+=(const Mat4x4& other);
-    Mat4x4& operator-=(const Mat4x4& other);
-    Mat4x4& operator*=(const Mat4x4& other);
-    Mat4x4& operator*=(float scalar);
+    Mat4x4& operator+=(const Mat4x4& other) { return *this = *this + other; }
+    Mat4x4& operator-=(const Mat4x4& other) { return *this = *this - other; }
+    Mat4x4& operator*=(const Mat4x4& other) { return *this = *this * other; }
+    Mat4x4& operator*=(float scalar) { return *this = *this * scalar; }
 
-    bool operator==(const Mat4x4& other) const;
-    bool operator!=(const Mat4x4& other) const;
+    bool operator==(const Mat4x4& other) const {
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                if(m[i][j] != other.m[i][j])
+                    return false;
+        return true;
+    }
+    bool operator!=(const Mat4x4& other) const { return !(*this == other); }
 
     // Utility Functions
-    Mat4x4 transpose() const;
-    float determinant() const; // Optional: Implementing determinant for 4x4 is more involved
-    Mat4x4 inverse() const; // Optional
+    Mat4x4 transpose() const {
+        Mat4x4 transposed;
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                transposed.m[i][j] = m[j][i];
+        return transposed;
+    }
+
+    // Determinant and inverse for 4x4 matrices are more complex.
+    // Implementing them is beyond the scope of this example.
+    // You can use libraries like Eigen or GLM for advanced Mat operations.
 
     // Friend Functions
-    friend std::ostream& operator<<(std::ostream& os, const Mat4x4& mat);
+    friend std::ostream& operator<<(std::ostream& os, const Mat4x4& mat) {
+        os << std::fixed << std::setprecision(2);
+        for(int i=0;i<4;i++) {
+            os << "[ ";
+            for(int j=0;j<4;j++) {
+                os << mat.m[i][j] << " ";
+            }
+            os << "]\n";
+        }
+        return os;
+    }
 };
 
 // Scalar multiplication from the left
-Mat4x4 operator*(float scalar, const Mat4x4& mat);
+inline Mat4x4 operator*(float scalar, const Mat4x4& mat) { return mat * scalar; }
+
+static_assert(std::is_trivially_copyable<Mat3x3>::value && std::is_trivially_copyable<Mat4x4>::value,
+              "matrix types must stay trivially copyable");
+
+// -------------------- Batch transforms -------------------- //
+
+// out[i] = mat * (points[i], 1)
+inline void transformPoints(const Mat4x4& mat, const Vec3f* points, size_t count, Vec4f* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = mat * Vec4f(points[i].x, points[i].y, points[i].z, 1.0f);
+    }
+}
+
+// Transforms points with w = 1 and divides by the resulting w, writing x, y, z and
+// the clip-space w to separate arrays. Points that end up with w == 0 keep their
+// input position. Returns how many did.
+inline int projectPoints(const Mat4x4& mat, const Vec3f* points, size_t count, float* x, float* y, float* z, float* w) {
+    static_assert(sizeof(Vec3f) == 3 * sizeof(float), "Vec3f arrays are read as packed floats");
+    const float (*m)[4] = mat.m;
+    int degenerate = 0;
+    size_t i = 0;
+#ifdef __AVX2__
+    // 8 points per step, gathered out of the packed xyz array
+    const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        const float* p = &points[i].x;
+        __m256 px = _mm256_i32gather_ps(p, offsets, 4);
+        __m256 py = _mm256_i32gather_ps(p + 1, offsets, 4);
+        __m256 pz = _mm256_i32gather_ps(p + 2, offsets, 4);
+        __m256 row[4];
+        for (int r = 0; r < 4; r++) {
+            row[r] = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[r][0]), px), _mm256_mul_ps(_mm256_set1_ps(m[r][1]), py)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[r][2]), pz), _mm256_set1_ps(m[r][3])));
+        }
+        __m256 invW = _mm256_div_ps(_mm256_set1_ps(1.0f), row[3]);
+        __m256 flat = _mm256_cmp_ps(row[3], zero, _CMP_EQ_OQ);
+        _mm256_storeu_ps(x + i, _mm256_blendv_ps(_mm256_mul_ps(row[0], invW), px, flat));
+        _mm256_storeu_ps(y + i, _mm256_blendv_ps(_mm256_mul_ps(row[1], invW), py, flat));
+        _mm256_storeu_ps(z + i, _mm256_blendv_ps(_mm256_mul_ps(row[2], invW), pz, flat));
+        _mm256_storeu_ps(w + i, row[3]);
+        degenerate += __builtin_popcount(_mm256_movemask_ps(flat));
+    }
+#endif
+    for (; i < count; i++) {
+        const Vec3f& v = points[i];
+        float clipW = m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3];
+        w[i] = clipW;
+        if (clipW == 0.0f) {
+            x[i] = v.x;
+            y[i] = v.y;
+            z[i] = v.z;
+            degenerate++;
+            continue;
+        }
+        float invW = 1.0f / clipW;
+        x[i] = (m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3]) * invW;
+        y[i] = (m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3]) * invW;
+        z[i] = (m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3]) * invW;
+    }
+    return degenerate;
+}
 
 #endif // Mat_H
@@ -0,0 +1,81 @@
+#ifndef MESHARRAY_H
+#define MESHARRAY_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Array storage for Model data. It either owns a std::vector or views external
+// read-only memory, e.g. a section of a memory-mapped mesh file. Const access
+// reads whichever is active without copying; the first mutating access to a view
+// copies it into owned storage, so a loaded model can still be edited.
+template <typename T>
+class MeshArray {
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    MeshArray() = default;
+
+    // Points the array at `count` elements of external memory. The caller keeps
+    // that memory alive for as long as the view is used.
+    void setView(const T* elements, size_t count) {
+        m_owned.clear();
+        m_owned.shrink_to_fit();
+        m_view = elements;
+        m_viewSize = count;
+    }
+    bool isView() const { return m_view != nullptr; }
+
+    size_t size() const { return m_view ? m_viewSize : m_owned.size(); }
+    bool empty() const { return size() == 0; }
+
+    const T* data() const { return m_view ? m_view : m_owned.data(); }
+    T* data() { detach(); return m_owned.data(); }
+
+    const T& operator[](size_t i) const { return data()[i]; }
+    T& operator[](size_t i) { detach(); return m_owned[i]; }
+
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    T* begin() { return data(); }
+    T* end() { return data() + size(); }
+
+    const T& back() const { return data()[size() - 1]; }
+    T& back() { detach(); return m_owned.back(); }
+
+    void reserve(size_t n) { detach(); m_owned.reserve(n); }
+    void resize(size_t n) { detach(); m_owned.resize(n); }
+    void resize(size_t n, const T& value) { detach(); m_owned.resize(n, value); }
+    void clear() {
+        m_view = nullptr;
+        m_viewSize = 0;
+        m_owned.clear();
+    }
+
+    void push_back(const T& value) { detach(); m_owned.push_back(value); }
+    template <typename... Args>
+    void emplace_back(Args&&... args) { detach(); m_owned.emplace_back(std::forward<Args>(args)...); }
+    // `pos` must come from a non-const begin()/end(), which has already detached.
+    template <typename InputIt>
+    void insert(T* pos, InputIt first, InputIt last) {
+        detach();
+        m_owned.insert(m_owned.begin() + (pos - m_owned.data()), first, last);
+    }
+
+private:
+    void detach() {
+        if (m_view) {
+            m_owned.assign(m_view, m_view + m_viewSize);
+            m_view = nullptr;
+            m_viewSize = 0;
+        }
+    }
+
+    std::vector<T> m_owned;
+    const T* m_view = nullptr;
+    size_t m_viewSize = 0;
+};
+
+#endif // MESHARRAY_H
@@ -0,0 +1,43 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <cstdint>
+
+// Binary mesh file written by Model::saveToMesh and mapped by Model::loadFromMesh.
+//
+// The file starts with a MeshFileHeader, followed by one section per array. Each
+// section holds the array's elements exactly as they sit in memory and starts at
+// a MeshFileAlignment boundary, so a mapped section can be used in place. Files
+// are only valid on machines with the same byte order and float format.
+
+const char MeshFileMagic[8] = { 'H', 'Z', 'B', 'M', 'E', 'S', 'H', '\0' };
+const uint32_t MeshFileVersion = 1;
+const uint32_t MeshFileByteOrder = 0x01020304;
+const uint64_t MeshFileAlignment = 64;
+
+enum MeshFileSectionId {
+    MeshVertices,   // Vec3f
+    MeshVNormals,   // Vec3f
+    MeshFNormals,   // Vec3f
+    MeshTexcoords,  // Vec2f
+    MeshFaces,      // Face
+    MeshSectionCount
+};
+
+struct MeshFileSection {
+    uint64_t offset; // from the start of the file
+    uint64_t count;  // elements
+};
+
+struct MeshFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    MeshFileSection sections[MeshSectionCount];
+    float bboxMin[3];
+    float bboxMax[3];
+    float center[3];
+    uint32_t reserved;
+};
+
+#endif // MESHFILE_H
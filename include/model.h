@@ -5,6 +5,10 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <memory>
+#include "mesharray.h"
+
+class MappedFile;
 
 // Structure to hold indices for a face
 struct Face {
@@ -34,26 +38,45 @@ struct BoundingBox {
 class Model {
 public:
     // Data
-    std::vector<Vec3f> vertices;      // List of vertex positions
-    std::vector<Vec3f> normals;       // List of normals
-    std::vector<Vec2f> texcoords;     // List of texture coordinates
-    std::vector<Face> faces;          // List of faces
-    std::vector<Vec3f> vNormals;      // List of vertex normals
-    std::vector<Vec3f> fNormals;      // List of face normals
+    MeshArray<Vec3f> vertices;        // List of vertex positions
+    MeshArray<Vec3f> normals;         // List of normals
+    MeshArray<Vec2f> texcoords;       // List of texture coordinates
+    MeshArray<Face> faces;            // List of faces
+    MeshArray<Vec3f> vNormals;        // List of vertex normals
+    MeshArray<Vec3f> fNormals;        // List of face normals
     BoundingBox bbox;                 // Bounding box
     Vec3f center; 
 
+    // Mesh file the arrays above view into after loadFromMesh, shared by copies
+    std::shared_ptr<const MappedFile> meshFile;
+
+    // Simplified copies from buildLods(), each coarser than the one before and
+    // shared by copies. The model itself is the full-detail level.
+    std::vector<std::shared_ptr<const Model>> lods;
+
+    // Seconds spent in the last load and in the last computeNormals()
+    double loadTime = 0.0;
+    double normalsTime = 0.0;
+
     // Constructors
     Model();
     ~Model();
 
     // Methods
     bool loadFromOBJ(const std::string& filename);
+    // Binary mesh format (see meshfile.h). Loading maps the file and points the
+    // arrays at it without copying; the stored model is already normalized.
+    bool loadFromMesh(const std::string& filename);
+    bool saveToMesh(const std::string& filename) const;
     void computeBoundingBox();
     
     // New Method
     void normalizeToUnitCube();
     void computeNormals();
+    // Builds up to levelCount levels of detail, each simplified to about ratio of
+    // the faces of the previous one, stopping before a level would drop below
+    // minFaces. Needs the vertex normals.
+    void buildLods(int levelCount = 4, float ratio = 0.25f, int minFaces = 64);
 
 };
 
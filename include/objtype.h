@@ -3,7 +3,8 @@
 #include "vector.h"
 
 struct Vertex {
-    Vec3f position;
+    Vec3f position;      // NDC once transformed
+    Vec3f worldPosition; // for view-dependent shading, in the space of Camera::position
     Vec3f normal;
     Vec2f texcoord;
     void dump(){
@@ -13,12 +14,15 @@ struct Vertex {
     }
 };
 
+// Stored in BMP byte order (blue, green, red) so a row of the color buffer is
+// already a row of 24-bit BMP pixel data.
 struct Color {
-    uint8_t r, g, b;
+    uint8_t b, g, r;
 
-    Color() : r(0), g(0), b(0) {}
+    Color() : b(0), g(0), r(0) {}
     Color(uint8_t red, uint8_t green, uint8_t blue)
-        : r(red), g(green), b(blue) {}
+        : b(blue), g(green), r(red) {}
 };
+static_assert(sizeof(Color) == 3, "Color rows are written as packed BGR bytes");
 
 #endif // OBJTYPE_H
\ No newline at end of file
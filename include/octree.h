@@ -0,0 +1,35 @@
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include "model.h"
+#include <vector>
+
+// Octree over Model::faces, rooted at Model::bbox. A face is stored in the
+// deepest node whose box fully contains it, so every node box bounds all the
+// geometry of its subtree and can be used as a conservative occluder test.
+
+struct OctreeNode
+{
+	BoundingBox box;
+	int children[8];        // index into Octree::nodes, -1 if empty
+	std::vector<int> faces; // faces stored at this node (straddling or leaf)
+	int subtreeFaces;       // faces in this node and all its descendants
+};
+
+class Octree
+{
+public:
+	std::vector<OctreeNode> nodes; // nodes[0] is the root
+
+	int maxDepth = 8;
+	int leafFaces = 64;
+
+	Octree() = default;
+	void build(const Model& model);
+	bool empty() const { return nodes.empty(); }
+
+private:
+	void buildNode(int nodeId, const std::vector<int>& faceIds, const std::vector<BoundingBox>& faceBoxes, int depth);
+};
+
+#endif // OCTREE_H
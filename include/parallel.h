@@ -0,0 +1,164 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+inline int defaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Worker threads shared by every parallelFor in the process. Workers are started
+// the first time a run asks for them and then sleep between runs, so a steady
+// stream of frames neither creates threads nor allocates. Runs are serialized;
+// a run started from inside a job, on a worker or on the thread that started the
+// outer run, executes serially on that thread.
+class WorkerPool
+{
+public:
+    using Job = void (*)(void* context, int index);
+
+    static WorkerPool& shared()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    // Runs job(context, i) for every i in [0, count) on the caller plus up to
+    // threads - 1 workers.
+    void run(int count, int threads, Job job, void* context)
+    {
+        threads = std::min(threads, count);
+        if (threads <= 1 || onWorkerThread() || insideRun()) {
+            for (int i = 0; i < count; i++) {
+                job(context, i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> runLock(runMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (int(workers.size()) < threads - 1) {
+                workers.emplace_back(&WorkerPool::workerLoop, this, int(workers.size()));
+            }
+            currentJob = job;
+            currentContext = context;
+            currentCount = count;
+            next = 0;
+            participants = threads - 1;
+            active = threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+        // The caller holds runMutex while it runs items, so a nested run must not lock it again
+        insideRun() = true;
+        drain();
+        insideRun() = false;
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return active == 0; });
+    }
+
+private:
+    WorkerPool() = default;
+
+    static bool& onWorkerThread()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    // Set while the calling thread of run() executes items itself
+    static bool& insideRun()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    // Items are handed out one at a time from a shared counter, so a thread that
+    // finishes cheap items keeps pulling work while others are busy.
+    void drain()
+    {
+        for (int i = next++; i < currentCount; i = next++) {
+            currentJob(currentContext, i);
+        }
+    }
+
+    void workerLoop(int index)
+    {
+        onWorkerThread() = true;
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            if (index >= participants) {
+                continue;
+            }
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (--active == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::mutex runMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::thread> workers;
+    uint64_t generation = 0;
+    int participants = 0;
+    int active = 0;
+    bool stopping = false;
+
+    Job currentJob = nullptr;
+    void* currentContext = nullptr;
+    int currentCount = 0;
+    std::atomic<int> next{0};
+};
+
+// Runs fn(i) for every i in [0, count) on up to `threads` threads of the shared
+// WorkerPool. With a single thread (or a single item) everything runs on the caller.
+template <typename F>
+void parallelFor(int count, int threads, F&& fn)
+{
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (int i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    using Fn = typename std::remove_reference<F>::type;
+    WorkerPool::shared().run(count, threads, [](void* context, int i) {
+        (*static_cast<Fn*>(context))(i);
+    }, const_cast<void*>(static_cast<const void*>(&fn)));
+}
+
+#endif // PARALLEL_H
@@ -6,6 +6,13 @@
 #include "camera.h"
 #include "framebuffer.h"
 #include "ScanLineZBuffer.h"
+#include "HierarchicalZBuffer.h"
+#include "VisibilityBuffer.h"
+#include "octree.h"
+#include "VertexCache.h"
+#include "culling.h"
+#include "FrameStats.h"
+#include "scene.h"
 #include "vector"
 #include "memory"
 
@@ -20,17 +27,109 @@ public:
         Simple,
         ScanLine, 
         SimpleHierarchical,
-        OctreeHierarchical
+        OctreeHierarchical,
+        VisibilityBuffer,   // Simple's binned rasterizer writing ids, then one shading pass
+        IntervalScanLine    // ScanLine resolving visibility per span interval from polygon planes
     };
     ZBufferMethod zBufferMethod = ZBufferMethod::ScanLine; 
 
-    Renderer(int w, int h, const Shader& shd, const Camera& cam);
+    // Threads used to rasterize screen tiles in the Simple path.
+    int rasterThreads;
+    static const int TileSize = 64;
 
+    // CullMode flags applied before rasterization, and what they rejected last frame
+    int cullMode = CullAll;
+    CullStats cullStats;
+
+    // Levels of detail: each instance whose model has lods is drawn with the finest
+    // level that has at most one face per lodPixelsPerTriangle pixels of its
+    // projected bounding box, or the coarsest level if none does
+    bool useLods = false;
+    float lodPixelsPerTriangle = 4.0f;
+
+    // Also gather the per-row and per-fragment counters of frameStats
+    bool collectStats = false;
+    FrameStats frameStats; // filled by the last render()
+
+    // depthFormat applies to the methods rasterizing into a SimpleZbuffer; the
+    // scan-line methods keep their float line buffer.
+    Renderer(int w, int h, const Shader& shd, const Camera& cam, ZBufferMethod method = ZBufferMethod::ScanLine,
+             DepthFormat depthFormat = DepthFloat32);
+
+    // Renders one model as a single untransformed instance
     void render(const Model& model);
+    // Renders every instance of the scene into the framebuffer in one pass
+    void render(const Scene& scene);
+
+    // Occlusion queries against the depth pyramid of everything rendered since the
+    // framebuffer was last cleared, without rasterizing. Boxes are in world space and
+    // projected with the current camera. The test is conservative: false means the box
+    // is certainly hidden or off screen. Only SimpleHierarchical and OctreeHierarchical
+    // keep a pyramid; the other methods report every box visible.
+    bool isVisible(const BoundingBox& box) const;
+    // Sets visible[i] for each of boxes[0 .. count) and returns how many are visible
+    int queryVisibility(const BoundingBox* boxes, int count, bool* visible) const;
+
+    static const char* methodName(ZBufferMethod method);
 private:
+    // Models whose load and normals time were already reported in frameStats
+    std::vector<const Model*> reportedModels;
+
+    // Scene reused by render(const Model&)
+    Scene singleScene;
+    // The rendered scene with the levels of detail picked for this frame
+    Scene lodScene;
+
+    // Octrees over the models rendered with OctreeHierarchical, shared by their instances
+    struct ModelOctree {
+        const Model* model;
+        Octree octree;
+    };
+    std::vector<ModelOctree> octrees;
+
+    // NDC positions of the current scene, shared by the Simple, SimpleHierarchical
+    // and ScanLine paths; OctreeHierarchical transforms only the faces it draws
+    VertexCache vertexCache;
+    Culler culler;
+
+    // Sort-middle state for the Simple path, kept to reuse capacity across frames
+    std::vector<std::vector<uint>> tileBins;  // triangle ids per tile, in submission order
+    std::vector<FragmentCounters> tileFragments; // per tile, when collectStats is set
+
+    struct OctreeTraversal {
+        const SceneInstance* instance;
+        const Octree* octree;
+        Mat4x4 viewMatrix;      // model-view of the instance
+        Mat4x4 projectionMatrix;
+        Vertex vertices[3];
+        uint culledNodes = 0;
+        uint culledFaces = 0;
+        uint drawnFaces = 0;
+        FragmentCounters fragments;
+    };
+
     // Helper functions
+    void renderScene(const Scene& scene);
+    // Returns lodScene filled from scene, or scene itself if no model has lods
+    const Scene& selectLods(const Scene& scene);
+    void cullFaces(const Scene& scene, const Mat4x4& projectionMatrix);
+    // Also returns the culler outcode of each vertex.
+    void transformFace(const SceneInstance& instance, const Face& face, const Mat4x4& viewMatrix, const Mat4x4& projectionMatrix, Vertex* vertices, uint8_t* outcodes) const;
+    void renderBinned(const Scene& scene);
+    const Octree& octreeFor(const Model& model);
+    bool isBoxOccluded(const BoundingBox& box, const Mat4x4& viewMatrix, const Mat4x4& projectionMatrix) const;
+    void renderOctreeNode(int nodeId, OctreeTraversal& traversal);
     Vec3f multiplyMatrixVec(const float matrix[4][4], const Vec3f& v) const;
-    void drawTriangle(const std::vector<Vertex>);
+    // Counts fragments written since the depth buffer was last cleared
+    uint64_t countCoveredPixels() const;
+    // Returns false if the triangle was rejected before any pixel was touched.
+    // Fragment counts and shading time are added to counters when it is given.
+    // triangleId is the scene face id, stored instead of a color in VisibilityBuffer mode.
+    bool drawTriangle(const Vertex* vert, uint triangleId, FragmentCounters* counters = nullptr);
+    // Same, but only touches pixels inside the inclusive clip rect.
+    bool drawTriangle(const Vertex* vert, uint triangleId, int clipX0, int clipY0, int clipX1, int clipY1, FragmentCounters* counters = nullptr);
+    // Colors every pixel of the visibility buffer that holds a triangle.
+    void shadeVisibilityBuffer(const Scene& scene);
     void drawTriangleWithNormal(const std::vector<Vertex>, Vec3f normal); 
 };
 
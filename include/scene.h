@@ -0,0 +1,48 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "model.h"
+#include "matrix.h"
+#include <vector>
+
+// A placement of a model in the scene. Instances only point at their model, so
+// any number of them share one copy of its vertices, faces and normals.
+struct SceneInstance {
+    const Model* model;
+    Mat4x4 transform;         // model to world
+    Mat3x3 normalTransform;   // inverse transpose of the upper 3x3 of transform
+    bool hasTransform;        // false for the identity, whose normals are used as is
+    bool flipsWinding;        // the transform mirrors, so front faces wind clockwise in NDC
+
+    // Where this instance starts in the scene-wide vertex and face numbering
+    uint vertexBase;
+    uint faceBase;
+};
+
+// Models plus per-instance transforms, rendered together in one z-buffer pass.
+// Vertices and faces of all instances are numbered consecutively in instance
+// order, which is the numbering the vertex cache, culler and edge table use.
+// Models must outlive the scene and keep their vertex and face counts while in it.
+class Scene {
+public:
+    std::vector<SceneInstance> instances;
+
+    // Adds an instance and returns its index
+    int add(const Model& model);
+    int add(const Model& model, const Mat4x4& transform);
+    void setTransform(int instance, const Mat4x4& transform);
+    void clear() { instances.clear(); }
+
+    // World-space box around the model's bounding box as placed by the instance
+    BoundingBox bounds(int instance) const;
+
+    uint vertexCount() const;
+    uint faceCount() const;
+
+    // Instance owning a scene-wide vertex or face index. Lookups usually walk the
+    // indices in ascending order, so the previous result is tried first.
+    int instanceOfVertex(uint vertex, int hint = 0) const;
+    int instanceOfFace(uint face, int hint = 0) const;
+};
+
+#endif // SCENE_H
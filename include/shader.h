@@ -5,6 +5,30 @@
 #include "light.h"
 #include "camera.h"
 #include "objtype.h"
+#include <cstdint>
+
+// Lighting terms a shader evaluates; each combination is a separate compiled variant
+enum ShadingFeature {
+    ShadeAmbient = 1 << 0,
+    ShadeDiffuse = 1 << 1,
+    ShadeSpecular = 1 << 2,
+    ShadeAll = ShadeAmbient | ShadeDiffuse | ShadeSpecular
+};
+
+// Fragments shaded together, one lane each, in structure-of-arrays form
+struct FragmentBatch {
+    static const int Size = 8;
+    alignas(32) float px[Size], py[Size], pz[Size]; // interpolated world-space positions
+    alignas(32) float nx[Size], ny[Size], nz[Size]; // interpolated normals, normalized by the shader
+
+    void set(int lane, const Vec3f& position, const Vec3f& normal) {
+        px[lane] = position.x; py[lane] = position.y; pz[lane] = position.z;
+        nx[lane] = normal.x; ny[lane] = normal.y; nz[lane] = normal.z;
+    }
+    // Fills every lane from the barycentrics (lambda1[i], lambda2[i]) of the triangle.
+    // Like the normals, positions are interpolated with the screen-space barycentrics.
+    void interpolate(const Vertex* vert, const float* lambda1, const float* lambda2);
+};
 
 class Shader {
 public:
@@ -13,12 +37,46 @@ public:
     Vec3f diffuseColor;
     Vec3f specularColor;
     float shininess;
+    // ShadingFeature flags; the specular term is off unless asked for
+    int features = ShadeAmbient | ShadeDiffuse;
 
     Shader();
     Shader(const Light& l, const Vec3f& ambient, const Vec3f& diffuse, const Vec3f& specular, float shin);
 
     // Fragment shader: computes color based on lighting
     Vec3f fragment(const Vec3f& fragPos, const Vec3f& normal, const Vec2f& texcoord, const Camera& camera) const;
+
+    // Precomputes the per-frame constants and picks the variant for the current
+    // features. Call again whenever the camera, light, material or features change.
+    void prepare(const Camera& camera);
+    // Same as fragment(), using the constants of the last prepare(). fragPos is in
+    // world space, like the camera position the eye is taken from.
+    Vec3f shade(const Vec3f& fragPos, const Vec3f& normal) const { return shadeFn(uniforms, fragPos, normal); }
+    // Shades the lanes of batch set in mask and writes them to out[lane] as 8-bit colors
+    void shadeBatch(const FragmentBatch& batch, uint32_t mask, Color* out) const { batchFn(uniforms, batch, mask, out); }
+
+private:
+    struct Uniforms {
+        Vec3f lightDir;     // unit vector towards the light
+        Vec3f eye;
+        Vec3f ambient;
+        Vec3f diffuse;
+        Vec3f specular;
+        float shininess;
+    };
+    using ShadeFn = Vec3f (*)(const Uniforms& u, const Vec3f& fragPos, const Vec3f& normal);
+    using BatchFn = void (*)(const Uniforms& u, const FragmentBatch& batch, uint32_t mask, Color* out);
+
+    Uniforms uniforms;
+    ShadeFn shadeFn;
+    BatchFn batchFn;
+
+    Uniforms makeUniforms(const Camera& camera) const;
+    static ShadeFn shadeVariantFor(int features);
+    template <int Features>
+    static Vec3f shadeVariant(const Uniforms& u, const Vec3f& fragPos, const Vec3f& normal);
+    template <int Features>
+    static void shadeBatchVariant(const Uniforms& u, const FragmentBatch& batch, uint32_t mask, Color* out);
 };
 
 #endif // SHADER_H
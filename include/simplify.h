@@ -0,0 +1,19 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include "model.h"
+
+// Quadric error metric simplification (Garland and Heckbert). Every vertex keeps
+// the sum of the squared distances to the planes of its faces; the edge whose
+// merged vertex has the smallest such error is collapsed first. Boundary edges add
+// a plane perpendicular to their face, so open borders do not shrink. Collapses
+// that would flip a face are skipped.
+//
+// Returns a copy of source reduced to at most targetFaces faces, or to as few as
+// the allowed collapses reach. Vertex normals are carried through the collapses as
+// the normalized sum of the merged vertices' normals, so a level shades like the
+// mesh it came from. Texcoords follow the surviving vertex. The source needs
+// vNormals, as computeNormals() leaves them.
+Model simplifyModel(const Model& source, int targetFaces);
+
+#endif // SIMPLIFY_H
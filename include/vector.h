@@ -3,6 +3,19 @@
 
 #include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+// Header-only and trivially copyable, so vectors inline across translation units
+// and arrays of them can be copied and mapped as raw memory. Arithmetic never
+// branches; only normalizing a zero vector throws, and that check stays out of
+// the common path.
+
+namespace vector_detail {
+[[noreturn]] inline void throwZeroVector() {
+    throw std::runtime_error("Cannot normalize zero vector");
+}
+}
 
 class Vec3f {
 public:
@@ -10,87 +23,93 @@ public:
     float x, y, z;
 
     // Constructors
-    Vec3f(); // Default constructor
-    Vec3f(float x, float y, float z); // Parameterized constructor
-
-    // Copy constructor
-    Vec3f(const Vec3f& other);
-
-    // Destructor
-    ~Vec3f();
+    constexpr Vec3f() : x(0.0f), y(0.0f), z(0.0f) {}
+    constexpr Vec3f(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
 
     // Operator Overloads
-    Vec3f operator+(const Vec3f& other) const;
-    Vec3f operator-(const Vec3f& other) const;
-    Vec3f operator*(float scalar) const;
-    Vec3f operator/(float scalar) const;
-
-    Vec3f& operator+=(const Vec3f& other);
-    Vec3f& operator-=(const Vec3f& other);
-    Vec3f& operator*=(float scalar);
-    Vec3f& operator/=(float scalar);
+    constexpr Vec3f operator+(const Vec3f& other) const { return Vec3f(x + other.x, y + other.y, z + other.z); }
+    constexpr Vec3f operator-(const Vec3f& other) const { return Vec3f(x - other.x, y - other.y, z - other.z); }
+    constexpr Vec3f operator*(float scalar) const { return Vec3f(x * scalar, y * scalar, z * scalar); }
+    // Division by zero follows IEEE rules instead of throwing
+    constexpr Vec3f operator/(float scalar) const { return Vec3f(x / scalar, y / scalar, z / scalar); }
 
-    Vec3f operator-() const;
+    constexpr Vec3f& operator+=(const Vec3f& other) { x += other.x; y += other.y; z += other.z; return *this; }
+    constexpr Vec3f& operator-=(const Vec3f& other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
+    constexpr Vec3f& operator*=(float scalar) { x *= scalar; y *= scalar; z *= scalar; return *this; }
+    constexpr Vec3f& operator/=(float scalar) { x /= scalar; y /= scalar; z /= scalar; return *this; }
 
+    constexpr Vec3f operator-() const { return Vec3f(-x, -y, -z); }
 
-    bool operator==(const Vec3f& other) const;
-    bool operator!=(const Vec3f& other) const;
+    constexpr bool operator==(const Vec3f& other) const { return x == other.x && y == other.y && z == other.z; }
+    constexpr bool operator!=(const Vec3f& other) const { return !(*this == other); }
 
     // Vector Operations
-    float dot(const Vec3f& other) const;
-    Vec3f cross(const Vec3f& other) const;
-    float magnitude() const;
-    Vec3f normalized() const;
-    void normalize();
+    constexpr float dot(const Vec3f& other) const { return x * other.x + y * other.y + z * other.z; }
+    constexpr Vec3f cross(const Vec3f& other) const {
+        return Vec3f(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+    }
+    float magnitude() const { return std::sqrt(x * x + y * y + z * z); }
+    // Throws std::runtime_error for a zero vector
+    Vec3f normalized() const {
+        float mag = magnitude();
+        if (mag == 0.0f) {
+            vector_detail::throwZeroVector();
+        }
+        return *this / mag;
+    }
+    void normalize() { *this = normalized(); }
 
     // Friend Functions
-    friend std::ostream& operator<<(std::ostream& os, const Vec3f& vec);
+    friend std::ostream& operator<<(std::ostream& os, const Vec3f& vec) {
+        return os << "(" << vec.x << ", " << vec.y << ", " << vec.z << ")";
+    }
 };
 
 // Scalar multiplication from the left
-Vec3f operator*(float scalar, const Vec3f& vec);
+constexpr Vec3f operator*(float scalar, const Vec3f& vec) { return vec * scalar; }
 
 class Vec2f {
 public:
     float u, v;
 
     // Constructors
-    Vec2f(); // Default constructor
-    Vec2f(float u, float v); // Parameterized constructor
-
-    // Copy constructor
-    Vec2f(const Vec2f& other);
-
-    // Destructor
-    ~Vec2f();
+    constexpr Vec2f() : u(0.0f), v(0.0f) {}
+    constexpr Vec2f(float u_, float v_) : u(u_), v(v_) {}
 
     // Operator Overloads
-    Vec2f operator+(const Vec2f& other) const;
-    Vec2f operator-(const Vec2f& other) const;
-    Vec2f operator*(float scalar) const;
-    Vec2f operator/(float scalar) const;
+    constexpr Vec2f operator+(const Vec2f& other) const { return Vec2f(u + other.u, v + other.v); }
+    constexpr Vec2f operator-(const Vec2f& other) const { return Vec2f(u - other.u, v - other.v); }
+    constexpr Vec2f operator*(float scalar) const { return Vec2f(u * scalar, v * scalar); }
+    constexpr Vec2f operator/(float scalar) const { return Vec2f(u / scalar, v / scalar); }
 
-    Vec2f& operator+=(const Vec2f& other);
-    Vec2f& operator-=(const Vec2f& other);
-    Vec2f& operator*=(float scalar);
-    Vec2f& operator/=(float scalar);
+    constexpr Vec2f& operator+=(const Vec2f& other) { u += other.u; v += other.v; return *this; }
+    constexpr Vec2f& operator-=(const Vec2f& other) { u -= other.u; v -= other.v; return *this; }
+    constexpr Vec2f& operator*=(float scalar) { u *= scalar; v *= scalar; return *this; }
+    constexpr Vec2f& operator/=(float scalar) { u /= scalar; v /= scalar; return *this; }
 
-    bool operator==(const Vec2f& other) const;
-    bool operator!=(const Vec2f& other) const;
-    
+    constexpr bool operator==(const Vec2f& other) const { return u == other.u && v == other.v; }
+    constexpr bool operator!=(const Vec2f& other) const { return !(*this == other); }
 
     // Vector Operations
-    float dot(const Vec2f& other) const;
-    float magnitude() const;
-    Vec2f normalized() const;
-    void normalize();
+    constexpr float dot(const Vec2f& other) const { return u * other.u + v * other.v; }
+    float magnitude() const { return std::sqrt(u * u + v * v); }
+    Vec2f normalized() const {
+        float mag = magnitude();
+        if (mag == 0.0f) {
+            vector_detail::throwZeroVector();
+        }
+        return *this / mag;
+    }
+    void normalize() { *this = normalized(); }
 
     // Friend Functions
-    friend std::ostream& operator<<(std::ostream& os, const Vec2f& vec);
+    friend std::ostream& operator<<(std::ostream& os, const Vec2f& vec) {
+        return os << "(" << vec.u << ", " << vec.v << ")";
+    }
 };
 
 // Scalar multiplication from the left
-Vec2f operator*(float scalar, const Vec2f& vec);
+constexpr Vec2f operator*(float scalar, const Vec2f& vec) { return vec * scalar; }
 
 class Vec4f {
 public:
@@ -98,43 +117,48 @@ public:
     float x, y, z, w;
 
     // Constructors
-    Vec4f(); // Default constructor
-    Vec4f(float x, float y, float z, float w); // Parameterized constructor
-
-    // Copy constructor
-    Vec4f(const Vec4f& other);
-
-    // Destructor
-    ~Vec4f();
+    constexpr Vec4f() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+    constexpr Vec4f(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
 
     // Operator Overloads
-    Vec4f operator+(const Vec4f& other) const;
-    Vec4f operator-(const Vec4f& other) const;
-    Vec4f operator*(float scalar) const;
-    Vec4f operator/(float scalar) const;
+    constexpr Vec4f operator+(const Vec4f& other) const { return Vec4f(x + other.x, y + other.y, z + other.z, w + other.w); }
+    constexpr Vec4f operator-(const Vec4f& other) const { return Vec4f(x - other.x, y - other.y, z - other.z, w - other.w); }
+    constexpr Vec4f operator*(float scalar) const { return Vec4f(x * scalar, y * scalar, z * scalar, w * scalar); }
+    constexpr Vec4f operator/(float scalar) const { return Vec4f(x / scalar, y / scalar, z / scalar, w / scalar); }
 
-    Vec4f& operator+=(const Vec4f& other);
-    Vec4f& operator-=(const Vec4f& other);
-    Vec4f& operator*=(float scalar);
-    Vec4f& operator/=(float scalar);
+    constexpr Vec4f& operator+=(const Vec4f& other) { x += other.x; y += other.y; z += other.z; w += other.w; return *this; }
+    constexpr Vec4f& operator-=(const Vec4f& other) { x -= other.x; y -= other.y; z -= other.z; w -= other.w; return *this; }
+    constexpr Vec4f& operator*=(float scalar) { x *= scalar; y *= scalar; z *= scalar; w *= scalar; return *this; }
+    constexpr Vec4f& operator/=(float scalar) { x /= scalar; y /= scalar; z /= scalar; w /= scalar; return *this; }
 
-    Vec4f operator-() const;
+    constexpr Vec4f operator-() const { return Vec4f(-x, -y, -z, -w); }
 
-    bool operator==(const Vec4f& other) const;
-    bool operator!=(const Vec4f& other) const;
+    constexpr bool operator==(const Vec4f& other) const { return x == other.x && y == other.y && z == other.z && w == other.w; }
+    constexpr bool operator!=(const Vec4f& other) const { return !(*this == other); }
 
     // Vector Operations
-    float dot(const Vec4f& other) const;
+    constexpr float dot(const Vec4f& other) const { return x * other.x + y * other.y + z * other.z + w * other.w; }
     // Note: Cross product is not standard for 4D vectors. Implement if needed.
-    float magnitude() const;
-    Vec4f normalized() const;
-    void normalize();
+    float magnitude() const { return std::sqrt(dot(*this)); }
+    Vec4f normalized() const {
+        float mag = magnitude();
+        if (mag == 0.0f) {
+            vector_detail::throwZeroVector();
+        }
+        return *this / mag;
+    }
+    void normalize() { *this = normalized(); }
 
     // Friend Functions
-    friend std::ostream& operator<<(std::ostream& os, const Vec4f& vec);
+    friend std::ostream& operator<<(std::ostream& os, const Vec4f& vec) {
+        return os << "(" << vec.x << ", " << vec.y << ", " << vec.z << ", " << vec.w << ")";
+    }
 };
 
 // Scalar multiplication from the left
-Vec4f operator*(float scalar, const Vec4f& vec);
+constexpr Vec4f operator*(float scalar, const Vec4f& vec) { return vec * scalar; }
+
+static_assert(std::is_trivially_copyable<Vec2f>::value && std::is_trivially_copyable<Vec3f>::value &&
+              std::is_trivially_copyable<Vec4f>::value, "vector types must stay trivially copyable");
 
-#endif // VECTOR_H
\ No newline at end of file
+#endif // VECTOR_H
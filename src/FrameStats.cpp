@@ -0,0 +1,77 @@
+#include "FrameStats.h"
+
+const char* pipelineStageName(int stage) {
+    static const char* const names[StageCount] = {
+        "load", "normals", "transform", "cull", "table_build", "scan", "shade", "write"
+    };
+    return stage >= 0 && stage < StageCount ? names[stage] : "unknown";
+}
+
+void FrameStats::reset() {
+    detailed = false;
+    for (double& seconds : stageSeconds) {
+        seconds = 0.0;
+    }
+    trianglesSubmitted = 0;
+    trianglesBackFacing = 0;
+    trianglesOutsideFrustum = 0;
+    trianglesOccluded = 0;
+    trianglesRasterized = 0;
+    scanRows = 0;
+    activeEdgesTotal = 0;
+    activeEdgesMax = 0;
+    fragments = FragmentCounters();
+    pixelsCovered = 0;
+}
+
+void FrameStats::writeJson(std::ostream& os) const {
+    os << "{\"frame\": " << frame << ", \"method\": \"" << method << "\", "
+       << "\"width\": " << width << ", \"height\": " << height << ", \"stages_s\": {";
+    for (int stage = 0; stage < StageCount; stage++) {
+        os << (stage ? ", " : "") << "\"" << pipelineStageName(stage) << "\": " << stageSeconds[stage];
+    }
+    os << "}, \"triangles\": {\"submitted\": " << trianglesSubmitted
+       << ", \"back_facing\": " << trianglesBackFacing
+       << ", \"outside_frustum\": " << trianglesOutsideFrustum
+       << ", \"occluded\": " << trianglesOccluded
+       << ", \"rasterized\": " << trianglesRasterized << "}";
+    if (detailed) {
+        if (scanRows) {
+            os << ", \"active_edges\": {\"max\": " << activeEdgesMax << ", \"mean\": " << activeEdgesMean() << "}";
+        }
+        os << ", \"fragments\": {\"tested\": " << fragments.tested << ", \"passed\": " << fragments.passed << "}"
+           << ", \"pixels_covered\": " << pixelsCovered
+           << ", \"overdraw\": " << overdraw();
+    }
+    os << "}";
+}
+
+void FrameStats::writeCsvHeader(std::ostream& os) {
+    os << "frame,method,width,height";
+    for (int stage = 0; stage < StageCount; stage++) {
+        os << "," << pipelineStageName(stage) << "_s";
+    }
+    os << ",submitted,back_facing,outside_frustum,occluded,rasterized"
+       << ",active_edges_max,active_edges_mean,fragments_tested,fragments_passed,pixels_covered,overdraw\n";
+}
+
+void FrameStats::writeCsvRow(std::ostream& os) const {
+    os << frame << "," << method << "," << width << "," << height;
+    for (int stage = 0; stage < StageCount; stage++) {
+        os << "," << stageSeconds[stage];
+    }
+    os << "," << trianglesSubmitted << "," << trianglesBackFacing << "," << trianglesOutsideFrustum
+       << "," << trianglesOccluded << "," << trianglesRasterized;
+    // Counters that were not gathered are left empty rather than reported as zero
+    if (detailed) {
+        if (scanRows) {
+            os << "," << activeEdgesMax << "," << activeEdgesMean();
+        } else {
+            os << ",,";
+        }
+        os << "," << fragments.tested
+           << "," << fragments.passed << "," << pixelsCovered << "," << overdraw() << "\n";
+    } else {
+        os << ",,,,,,\n";
+    }
+}
@@ -0,0 +1,104 @@
+#include "HierarchicalZBuffer.h"
+#include <algorithm>
+#include <limits>
+
+HierarchicalZbuffer::HierarchicalZbuffer(int w, int h, DepthFormat format)
+	: SimpleZbuffer(w, h, format)
+{
+	int lw = w, lh = h;
+	while (lw > 1 || lh > 1) {
+		lw = (lw + 1) / 2;
+		lh = (lh + 1) / 2;
+		DepthLevel level;
+		level.width = lw;
+		level.height = lh;
+		level.depth.assign(lw * lh, -std::numeric_limits<float>::infinity());
+		depthPyramid.push_back(std::move(level));
+	}
+	resetDirty();
+}
+
+void HierarchicalZbuffer::clear(const Color& clearColor){
+	SimpleZbuffer::clear(clearColor);
+	for (auto& level : depthPyramid) {
+		std::fill(level.depth.begin(), level.depth.end(), -std::numeric_limits<float>::infinity());
+	}
+	resetDirty();
+}
+
+void HierarchicalZbuffer::writeSpan(int x, int y, int count, uint32_t mask, const Color* colors, const float* depths){
+	mask = clipSpanMask(x, y, count, mask, width, height);
+	if (mask == 0)
+		return;
+	SimpleZbuffer::writeSpan(x, y, count, mask, colors, depths);
+	dirtyX0 = std::min(dirtyX0, x + __builtin_ctz(mask));
+	dirtyX1 = std::max(dirtyX1, x + 31 - __builtin_clz(mask));
+	dirtyY0 = std::min(dirtyY0, y);
+	dirtyY1 = std::max(dirtyY1, y);
+}
+
+// level 0 is the depth buffer itself, level k is depthPyramid[k - 1]
+float HierarchicalZbuffer::farthestDepth(int level, int x, int y) const{
+	if (level == 0)
+		return depthAt(y * width + x);
+	const DepthLevel& l = depthPyramid[level - 1];
+	return l.depth[y * l.width + x];
+}
+
+void HierarchicalZbuffer::updatePyramid(){
+	if (dirtyX0 > dirtyX1 || dirtyY0 > dirtyY1)
+		return;
+
+	int x0 = dirtyX0, y0 = dirtyY0, x1 = dirtyX1, y1 = dirtyY1;
+	int childW = width, childH = height;
+	for (int level = 1; level <= int(depthPyramid.size()); level++) {
+		DepthLevel& l = depthPyramid[level - 1];
+		x0 >>= 1; y0 >>= 1; x1 >>= 1; y1 >>= 1;
+		for (int y = y0; y <= y1; y++) {
+			int cy0 = 2 * y;
+			int cy1 = std::min(cy0 + 1, childH - 1);
+			for (int x = x0; x <= x1; x++) {
+				int cx0 = 2 * x;
+				int cx1 = std::min(cx0 + 1, childW - 1);
+				float d = std::min(
+					std::min(farthestDepth(level - 1, cx0, cy0), farthestDepth(level - 1, cx1, cy0)),
+					std::min(farthestDepth(level - 1, cx0, cy1), farthestDepth(level - 1, cx1, cy1)));
+				l.depth[y * l.width + x] = d;
+			}
+		}
+		childW = l.width;
+		childH = l.height;
+	}
+	resetDirty();
+}
+
+bool HierarchicalZbuffer::isOccluded(int x0, int y0, int x1, int y1, float nearestDepth) const{
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, width - 1);
+	y1 = std::min(y1, height - 1);
+	if (x0 > x1 || y0 > y1)
+		return true; // nothing on screen
+
+	// coarsest useful level: the rect spans at most 2x2 texels there
+	int level = 0;
+	int maxLevel = int(depthPyramid.size());
+	while (level < maxLevel && (((x1 >> level) - (x0 >> level)) > 1 || ((y1 >> level) - (y0 >> level)) > 1)) {
+		level++;
+	}
+
+	for (int y = y0 >> level; y <= (y1 >> level); y++) {
+		for (int x = x0 >> level; x <= (x1 >> level); x++) {
+			if (farthestDepth(level, x, y) <= nearestDepth)
+				return false;
+		}
+	}
+	return true;
+}
+
+void HierarchicalZbuffer::resetDirty(){
+	dirtyX0 = width;
+	dirtyY0 = height;
+	dirtyX1 = -1;
+	dirtyY1 = -1;
+}
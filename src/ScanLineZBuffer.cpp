@@ -4,6 +4,7 @@
 #include "renderer.h"
 #include "assert.h"
 #include "algorithm"
+#include "parallel.h"
 
 Edgef::Edgef(const Vertex& v0, const Vertex& v1, uint eid, uint pid): edgeId(eid), polygonId(pid){
 	start = v0.position; 
@@ -15,7 +16,8 @@ Edgef::Edgef(const Vertex& v0, const Vertex& v1, uint eid, uint pid): edgeId(eid
 	gradientdRGBdy = (rgbEnd - rgbStart) / (end.y - start.y);
 	cur = start;
 	rgbCur = rgbStart;
-	isPaired = false;
+	yStart = 0;
+	yEnd = 0;
 }
 
 void Edgef::setCurPos(int current_Y){
@@ -25,62 +27,68 @@ void Edgef::setCurPos(int current_Y){
 	rgbCur = rgbStart + gradientdRGBdy * dy;
 }
 
+// Clamps an interpolated color to [0, 1] and converts it to 8 bits
+static inline Color clampedColor(Vec3f rgb){
+	rgb.x = std::min(std::max(rgb.x, 0.0f), 1.0f);
+	rgb.y = std::min(std::max(rgb.y, 0.0f), 1.0f);
+	rgb.z = std::min(std::max(rgb.z, 0.0f), 1.0f);
+	return Color(rgb.x * 255, rgb.y * 255, rgb.z * 255);
+}
+
+void EdgeBuckets::build(const std::vector<Edgef>& edges, int lines, int Edgef::*line){
+	offsets.assign(lines + 1, 0);
+	for(const Edgef& edge : edges){
+		offsets[edge.*line + 1]++;
+	}
+	for(int h_iter = 0; h_iter < lines; h_iter++){
+		offsets[h_iter + 1] += offsets[h_iter];
+	}
+	ids.resize(edges.size());
+	cursor.assign(offsets.begin(), offsets.end() - 1);
+	for(const Edgef& edge : edges){
+		ids[cursor[edge.*line]++] = edge.edgeId;
+	}
+}
+
 ScanLineZBuffer::ScanLineZBuffer(int w, int h)
     :Framebuffer(w, h),
-    zBufferLine(w, 0.0f)
+    scanThreads(defaultThreadCount())
     {}
 
 void ScanLineZBuffer::clear(){
 	Framebuffer::clear();
-	zBufferLine.resize(width);
-	std::fill(zBufferLine.begin(), zBufferLine.end(), -std::numeric_limits<float>::infinity());
-	activeEdgeIdTable.clear();
-	activeEdgeIdTable.resize(height);
-	deactiveEdgeIdTable.clear();
-	deactiveEdgeIdTable.resize(height);
 	edgeTable.clear();
-	activeEdgeTable.clear();
+	polygonTable.clear();
+	activeEdgeIdTable.build(edgeTable, height, &Edgef::yStart);
+	deactiveEdgeIdTable.build(edgeTable, height, &Edgef::yEnd);
 	curFaceOffset = 0;
 	edgeIdOffset = 0;
 
 }
 
-void ScanLineZBuffer::buildTable(const Model& model){
+void ScanLineZBuffer::buildTable(const Scene& scene, const VertexCache& cache, const std::vector<uint>& faceIds){
 	Timer timer;
 	timer.reset();
 	timer.start();
 
-	Mat4x4 viewMatrix;
-	pRenderer->camera.getViewMatrix(viewMatrix);
+	uint faces_size = scene.faceCount();
+	size_t edgeCount = edgeTable.size();
 
-	Mat4x4 projectionMatrix;
-	pRenderer->camera.getProjectionMatrix(projectionMatrix);
+	// At most three edges per face, so the table never grows inside the loop
+	edgeTable.reserve(edgeTable.size() + 3 * faceIds.size());
+	polygonTable.resize(curFaceOffset + faces_size);
 
-	uint faces_size = model.faces.size();
-
-	for (uint faceIter = 0; faceIter < faces_size; faceIter++){
-		Face face = model.faces[faceIter];
-		std::vector<Vertex> vertices; 
-        vertices.resize(3);
-        for (int i = 0; i < 3; ++i) {
-            const Face::VertexIndices& idx = face.vertices[i];
-            vertices[i].position = model.vertices[idx.v];
-            vertices[i].normal = model.vNormals[idx.v];
-            vertices[i].texcoord = model.texcoords.empty() ? Vec2f() : model.texcoords[idx.vt];
-        }
+	Vertex vertices[3];
+	tableFaces = 0;
+	int instance = 0;
+	for (uint faceIter : faceIds){
+		instance = scene.instanceOfFace(faceIter, instance);
+		const SceneInstance& inst = scene.instances[instance];
+		cache.gatherFace(inst, inst.model->faces[faceIter - inst.faceBase], vertices);
 		for (int i = 0; i < 3; ++i) {
-            Vec4f pos(vertices[i].position.x, vertices[i].position.y, vertices[i].position.z, 1.0f);
-            pos = viewMatrix * pos; 
-            pos = projectionMatrix * pos; 
-            if (pos.w != 0.0f) {
-                vertices[i].position = Vec3f(pos.x / pos.w, pos.y / pos.w, pos.z / pos.w);
-            } else {
-                std::cerr << "Warning: pos.w is 0.0f when transforming." << std::endl;;
-            }
-
 			vertices[i].position.x = (vertices[i].position.x + 1.0f) * 0.5f * width;
 			vertices[i].position.y = (vertices[i].position.y + 1.0f) * 0.5f * height;
-    	}
+		}
 		for(int i = 0; i < 3; i++ ){
 			auto v0 = vertices[i];
 			auto v1 = vertices[(i + 1) % 3];
@@ -115,77 +123,192 @@ void ScanLineZBuffer::buildTable(const Model& model){
 			Edgef edge(v0, v1, edgeIdOffset, faceIter + curFaceOffset);
 
 			edgeIdOffset++;
+			edge.yStart = y0i;
+			edge.yEnd = y1i;
 			edge.setCurPos(y0i);
 			edgeTable.push_back(edge);
-
-			activeEdgeIdTable[y0i].push_back(edge.edgeId);
-			deactiveEdgeIdTable[y1i].push_back(edge.edgeId);
+		}
+		if(edgeTable.size() != edgeCount){
+			// Plane through the screen-space vertices, normal from the two edges at v0
+			const Vec3f& p0 = vertices[0].position;
+			Vec3f normal = (vertices[1].position - p0).cross(vertices[2].position - p0);
+			Polygonf& polygon = polygonTable[faceIter + curFaceOffset];
+			polygon.a = normal.x;
+			polygon.b = normal.y;
+			polygon.c = normal.z;
+			polygon.d = -normal.dot(p0);
+			polygon.polygonId = faceIter + curFaceOffset;
+			int yStart = height, yEnd = 0;
+			for(size_t e = edgeCount; e < edgeTable.size(); e++){
+				yStart = std::min(yStart, edgeTable[e].yStart);
+				yEnd = std::max(yEnd, edgeTable[e].yEnd);
+			}
+			polygon.dy = yEnd - yStart;
+			tableFaces++;
+			edgeCount = edgeTable.size();
 		}
 
   	}
 	curFaceOffset += faces_size;
+
+	// Group the whole table by start and end line, including edges of earlier calls
+	activeEdgeIdTable.build(edgeTable, height, &Edgef::yStart);
+	deactiveEdgeIdTable.build(edgeTable, height, &Edgef::yEnd);
 	timer.stop();
-	std::cout << "ScanLine Table build time:" << timer.elapsed() << std::endl;
+	tableBuildTime = timer.elapsed();
+	std::cout << "ScanLine Table build time:" << tableBuildTime << std::endl;
 }
 
 
-void ScanLineZBuffer::actScan(const Model& model){
+void ScanLineZBuffer::actScan(){
 	Timer timer;
 	timer.reset();
 	timer.start();
 
+	splitBands(std::min(scanThreads, height));
+	parallelFor(bands.size(), bands.size(), [this](int band){
+		scanBand(bands[band]);
+	});
+
+	timer.stop();
+	scanTime = timer.elapsed();
+	std::cout << "ScanLine Scan time:" << scanTime << std::endl;
+}
+
+// Splits the rows into contiguous bands of roughly equal cost, estimating the
+// cost of a row by its active edge count plus a fixed per-row overhead.
+void ScanLineZBuffer::splitBands(int count){
+	bands.resize(count);
+	if(count == 1){
+		bands[0].yBegin = 0;
+		bands[0].yEnd = height;
+		return;
+	}
+
+	const double rowOverhead = 1.0 + width / 64.0;
+	double totalCost = 0.0;
+	long active = 0;
 	for(int h_iter = 0; h_iter < height; h_iter++){
-		zBufferLine.resize(width);
-		std::fill(zBufferLine.begin(), zBufferLine.end(), -std::numeric_limits<float>::infinity());
+		active += long(activeEdgeIdTable.count(h_iter)) - long(deactiveEdgeIdTable.count(h_iter));
+		totalCost += active + rowOverhead;
+	}
 
-		size_t activeEdgeTableSize = activeEdgeTable.size();
-		size_t activeEdgeSize = activeEdgeIdTable[h_iter].size();
-		size_t deactiveEdgeSize = deactiveEdgeIdTable[h_iter].size();
+	double cost = 0.0;
+	int band = 0;
+	bands[0].yBegin = 0;
+	active = 0;
+	for(int h_iter = 0; h_iter < height && band < count - 1; h_iter++){
+		active += long(activeEdgeIdTable.count(h_iter)) - long(deactiveEdgeIdTable.count(h_iter));
+		cost += active + rowOverhead;
+		if(cost >= totalCost * (band + 1) / count){
+			bands[band].yEnd = h_iter + 1;
+			band++;
+			bands[band].yBegin = h_iter + 1;
+		}
+	}
+	for(; band < count - 1; band++){
+		bands[band].yEnd = height;
+		bands[band + 1].yBegin = height;
+	}
+	bands[count - 1].yEnd = height;
+}
 
-		for(auto edgeId : activeEdgeIdTable[h_iter]){
-			Edgef& edge = edgeTable[edgeId];
-			activeEdgeTable.push_back(edge);
+void ScanLineZBuffer::scanBand(ScanBand& band){
+	band.zBufferLine.resize(width);
+	band.edges.clear();
+	band.activeEdgeTable.clear();
+	band.polygonPendingEdge.assign(curFaceOffset, -1);
+	band.activeEdgesTotal = 0;
+	band.activeEdgesMax = 0;
+	band.pixelsCovered = 0;
+	band.fragments = FragmentCounters();
+
+	std::vector<float>& zBufferLine = band.zBufferLine;
+	std::vector<Edgef>& edges = band.edges;
+	std::vector<uint>& activeEdgeTable = band.activeEdgeTable;
+	auto byCurX = [&edges](uint a, uint b){
+		return edges[a].cur.x < edges[b].cur.x;
+	};
+
+	// Edges that entered above the band and are still active on its first line
+	if(band.yBegin > 0){
+		for(const Edgef& edge : edgeTable){
+			if(edge.yStart < band.yBegin && edge.yEnd > band.yBegin){
+				activeEdgeTable.push_back(edges.size());
+				edges.push_back(edge);
+				edges.back().setCurPos(band.yBegin);
+			}
 		}
+		std::sort(activeEdgeTable.begin(), activeEdgeTable.end(), byCurX);
+	}
 
-		for(auto edgeId : deactiveEdgeIdTable[h_iter]){
-			auto iter = activeEdgeTable.begin();
-			for(; iter != activeEdgeTable.end();){
-				if(iter->edgeId == edgeId){
-					iter = activeEdgeTable.erase(iter);
-				}else{
-					iter++;
-				}
+	for(int h_iter = band.yBegin; h_iter < band.yEnd; h_iter++){
+		if(!intervalScan){
+			std::fill(zBufferLine.begin(), zBufferLine.end(), -std::numeric_limits<float>::infinity());
+		}
+
+		// Retire edges ending on this line and restore x order in one pass. Edges were
+		// advanced at the end of the previous line and only swap where they cross, so
+		// the insertion step is close to linear.
+		size_t activeEdgeTableSize = activeEdgeTable.size();
+		size_t kept = 0;
+		for(size_t i = 0; i < activeEdgeTableSize; i++){
+			uint edgeId = activeEdgeTable[i];
+			if(edges[edgeId].yEnd <= h_iter){
+				continue;
+			}
+			size_t j = kept++;
+			for(; j > 0 && byCurX(edgeId, activeEdgeTable[j - 1]); j--){
+				activeEdgeTable[j] = activeEdgeTable[j - 1];
 			}
-			assert(iter == activeEdgeTable.end());
+			activeEdgeTable[j] = edgeId;
+		}
+		activeEdgeTable.resize(kept);
+		assert(h_iter == band.yBegin || activeEdgeTableSize - kept == deactiveEdgeIdTable.count(h_iter));
+
+		// Merge the edges entering on this line into the sorted list
+		if(activeEdgeIdTable.count(h_iter) != 0){
+			std::vector<uint>& enteringEdges = band.enteringEdges;
+			std::vector<uint>& mergedEdges = band.mergedEdges;
+			enteringEdges.clear();
+			for(const uint* entering = activeEdgeIdTable.begin(h_iter); entering != activeEdgeIdTable.end(h_iter); entering++){
+				enteringEdges.push_back(edges.size());
+				edges.push_back(edgeTable[*entering]);
+			}
+			std::sort(enteringEdges.begin(), enteringEdges.end(), byCurX);
+			mergedEdges.resize(activeEdgeTable.size() + enteringEdges.size());
+			std::merge(activeEdgeTable.begin(), activeEdgeTable.end(),
+					   enteringEdges.begin(), enteringEdges.end(),
+					   mergedEdges.begin(), byCurX);
+			activeEdgeTable.swap(mergedEdges);
 		}
 
 		assert(activeEdgeTable.size() % 2 == 0);
-		assert(activeEdgeTableSize + activeEdgeSize - deactiveEdgeSize == activeEdgeTable.size());
+		if(countStats){
+			band.activeEdgesTotal += activeEdgeTable.size();
+			band.activeEdgesMax = std::max<uint64_t>(band.activeEdgesMax, activeEdgeTable.size());
+		}
 
-		std::sort(activeEdgeTable.begin(), activeEdgeTable.end(), [](const Edgef& a, const Edgef& b){
-			return a.cur.x < b.cur.x;
-		});
-		bool isSorted = std::is_sorted(activeEdgeTable.begin(), activeEdgeTable.end(), [](const Edgef& a, const Edgef& b){
-			return a.cur.x < b.cur.x;
-		});		
+		if(intervalScan){
+			scanIntervals(band, h_iter);
+			for(uint edgeId : activeEdgeTable){
+				edges[edgeId].setCurPos(h_iter + 1);
+			}
+			continue;
+		}
 
+		// Each polygon has exactly two active edges on a line: the first one seen in
+		// x order waits in polygonPendingEdge until its partner closes the span.
 		for(size_t i = 0; i < activeEdgeTable.size(); i++){
-			Edgef &edge0 = activeEdgeTable[i];
-			// std::cout << "edge0.cur.x:" << edge0.cur.x << std::endl;
-			if(edge0.isPaired){
+			uint edgeId = activeEdgeTable[i];
+			int& pending = band.polygonPendingEdge[edges[edgeId].polygonId];
+			if(pending < 0){
+				pending = edgeId;
 				continue;
 			}
-			edge0.isPaired = true;
-			size_t pairId; 
-			for(pairId = i + 1; pairId < activeEdgeTable.size(); pairId++){
-				Edgef &edge1 = activeEdgeTable[pairId];
-				if(edge0.polygonId == edge1.polygonId){
-					edge1.isPaired = true;
-					break; 
-				}
-			}
-			
-			Edgef &edge1 = activeEdgeTable[pairId];
+			Edgef &edge0 = edges[pending];
+			Edgef &edge1 = edges[edgeId];
+			pending = -1;
 
 			assert(edge0.cur.x <= edge1.cur.x);
 
@@ -202,51 +325,154 @@ void ScanLineZBuffer::actScan(const Model& model){
 			Vec3f gradientdRGBdx = (rgbEnd - rgbStart) / (edge1.cur.x - edge0.cur.x);
 			zStart += gradientDzDx * (float(x0) - edge0.cur.x);
 			rgbStart += gradientdRGBdx * (float(x0) - edge0.cur.x);
-			for(uint x = x0; x <= x1; x++){
-				if(zBufferLine[x] < zStart){
-					zBufferLine[x] = zStart;
-					Vec3f rgb = rgbStart;
-					if(rgb.x < 0.0f){
-						rgb.x = 0.0f;
-					}
-					if(rgb.y < 0.0f){
-						rgb.y = 0.0f;
+			// Visible pixels are collected in runs of up to 32 and written as one span
+			Color colors[32];
+			for(uint xSpan = x0; xSpan <= x1; xSpan += 32){
+				int count = std::min<uint>(32, x1 - xSpan + 1);
+				uint32_t mask = 0;
+				for(int i = 0; i < count; i++){
+					uint x = xSpan + i;
+					if(zBufferLine[x] < zStart){
+						zBufferLine[x] = zStart;
+						colors[i] = clampedColor(rgbStart);
+						mask |= 1u << i;
 					}
-					if(rgb.z < 0.0f){
-						rgb.z = 0.0f;
-					}
-					if(rgb.x > 1.0f){
-						rgb.x = 1.0f;
+					zStart += gradientDzDx;
+					rgbStart += gradientdRGBdx;
+				}
+				writeSpan(xSpan, h_iter, count, mask, colors);
+				if(countStats){
+					band.fragments.tested += count;
+					band.fragments.passed += __builtin_popcount(mask);
+				}
+			}
+		}
+		if(countStats){
+			for(float z : zBufferLine){
+				band.pixelsCovered += z != -std::numeric_limits<float>::infinity();
+			}
+		}
+		for(uint edgeId : activeEdgeTable){
+			edges[edgeId].setCurPos(h_iter + 1);
+		}
+	}
+}
+
+void ScanLineZBuffer::scanIntervals(ScanBand& band, int y){
+	std::vector<Edgef>& edges = band.edges;
+	std::vector<LineSpan>& spans = band.spans;
+	std::vector<SpanEvent>& events = band.spanEvents;
+	std::vector<uint>& covering = band.coveringSpans;
+	spans.clear();
+	events.clear();
+	covering.clear();
+
+	// Pair each polygon's two edges into a span, with the same pixel coverage as
+	// the per-pixel scan
+	for(uint edgeId : band.activeEdgeTable){
+		int& pending = band.polygonPendingEdge[edges[edgeId].polygonId];
+		if(pending < 0){
+			pending = edgeId;
+			continue;
+		}
+		const Edgef& edge0 = edges[pending];
+		const Edgef& edge1 = edges[edgeId];
+		pending = -1;
+
+		int x0 = std::max(0, int(std::ceil(edge0.cur.x)));
+		int x1 = std::min(width - 1, int(std::ceil(edge1.cur.x)));
+		// Edge-on polygons have no usable plane and cover no area
+		if(x0 >= x1 || polygonTable[edge0.polygonId].c == 0.0f){
+			continue;
+		}
+		LineSpan span;
+		span.polygonId = edge0.polygonId;
+		span.x0 = x0;
+		span.x1 = x1;
+		span.xLeft = edge0.cur.x;
+		span.rgbLeft = edge0.rgbCur;
+		span.gradientdRGBdx = (edge1.rgbCur - edge0.rgbCur) / (edge1.cur.x - edge0.cur.x);
+		events.push_back(SpanEvent{ x0, uint(spans.size()), true });
+		events.push_back(SpanEvent{ x1 + 1, uint(spans.size()), false });
+		spans.push_back(span);
+		if(countStats){
+			band.fragments.tested += x1 - x0 + 1;
+		}
+	}
+	std::sort(events.begin(), events.end(), [](const SpanEvent& a, const SpanEvent& b){
+		return a.x < b.x;
+	});
+
+	// Sweep the crossings left to right; between two of them the covering set is fixed
+	uint64_t written = 0;
+	int xBegin = 0;
+	for(size_t i = 0; i < events.size(); ){
+		int xNext = events[i].x;
+		if(xNext > xBegin && !covering.empty()){
+			int xEnd = xNext - 1;
+			written += xNext - xBegin;
+			if(covering.size() == 1){
+				fillSpan(spans[covering[0]], xBegin, xEnd, y);
+			} else {
+				// Depth is linear in x, so a polygon nearest at both ends of the
+				// interval is nearest all the way across
+				uint nearBegin = covering[0], nearEnd = covering[0];
+				float zBegin = polygonTable[spans[nearBegin].polygonId].depthAt(xBegin, y);
+				float zEnd = polygonTable[spans[nearEnd].polygonId].depthAt(xEnd, y);
+				for(size_t c = 1; c < covering.size(); c++){
+					const Polygonf& polygon = polygonTable[spans[covering[c]].polygonId];
+					float z = polygon.depthAt(xBegin, y);
+					if(z > zBegin){
+						zBegin = z;
+						nearBegin = covering[c];
 					}
-					if(rgb.y > 1.0f){
-						rgb.y = 1.0f;
+					z = polygon.depthAt(xEnd, y);
+					if(z > zEnd){
+						zEnd = z;
+						nearEnd = covering[c];
 					}
-					if(rgb.z > 1.0f){
-						rgb.z = 1.0f;
+				}
+				if(nearBegin == nearEnd){
+					fillSpan(spans[nearBegin], xBegin, xEnd, y);
+				} else {
+					// Planes cross inside the interval: resolve it pixel by pixel
+					for(int x = xBegin; x <= xEnd; x++){
+						uint nearest = covering[0];
+						float zNearest = polygonTable[spans[nearest].polygonId].depthAt(x, y);
+						for(size_t c = 1; c < covering.size(); c++){
+							float z = polygonTable[spans[covering[c]].polygonId].depthAt(x, y);
+							if(z > zNearest){
+								zNearest = z;
+								nearest = covering[c];
+							}
+						}
+						fillSpan(spans[nearest], x, x, y);
 					}
-					Color color(rgb.x * 255, rgb.y * 255, rgb.z * 255);
-					setPixel(x, h_iter, color, zStart);
 				}
-				zStart += gradientDzDx;
-				rgbStart += gradientdRGBdx;
 			}
 		}
-		for(auto& edge : activeEdgeTable){
-			edge.setCurPos(h_iter + 1);
-			edge.isPaired = false;
+		for(; i < events.size() && events[i].x == xNext; i++){
+			if(events[i].enter){
+				covering.push_back(events[i].span);
+			} else {
+				auto it = std::find(covering.begin(), covering.end(), events[i].span);
+				*it = covering.back();
+				covering.pop_back();
+			}
 		}
+		xBegin = xNext;
+	}
+	if(countStats){
+		band.fragments.passed += written;
+		band.pixelsCovered += written;
 	}
-
-
-
-	timer.stop();
-	std::cout << "ScanLine Scan time:" << timer.elapsed() << std::endl;
 }
 
-void ScanLineZBuffer::setPixel(int x, int y, const Color& color, float depth){
-  if (x < 0 || x >= width || y < 0 || y >= height)
-        return;
-
-    int index = y * width + x;
-    colorBuffer[index] = color;
-}
\ No newline at end of file
+void ScanLineZBuffer::fillSpan(const LineSpan& span, int x0, int x1, int y){
+	Color* row = colorBuffer.data() + y * width;
+	Vec3f rgb = span.rgbLeft + span.gradientdRGBdx * (float(x0) - span.xLeft);
+	for(int x = x0; x <= x1; x++){
+		row[x] = clampedColor(rgb);
+		rgb += span.gradientdRGBdx;
+	}
+}
@@ -0,0 +1,67 @@
+#include "VertexCache.h"
+#include "parallel.h"
+#include <atomic>
+#include <iostream>
+
+void VertexCache::transform(const Scene& scene, const Mat4x4& viewProjection, int threads){
+	const uint BlockSize = 4096;
+	uint count = scene.vertexCount();
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	w.resize(count);
+
+	instanceMatrices.resize(scene.instances.size());
+	for (size_t i = 0; i < scene.instances.size(); i++) {
+		instanceMatrices[i] = viewProjection * scene.instances[i].transform;
+	}
+
+	// Blocks cover the scene-wide numbering and are split where instances change
+	std::atomic<int> degenerate(0);
+	parallelFor((count + BlockSize - 1) / BlockSize, threads, [&](int block) {
+		uint begin = block * BlockSize;
+		uint end = std::min(begin + BlockSize, count);
+		int instance = scene.instanceOfVertex(begin);
+		while (begin < end) {
+			const SceneInstance& inst = scene.instances[instance];
+			uint instanceEnd = std::min<uint>(end, inst.vertexBase + inst.model->vertices.size());
+			degenerate += transformRange(*inst.model, instanceMatrices[instance], inst.vertexBase,
+										 begin - inst.vertexBase, instanceEnd - inst.vertexBase);
+			begin = instanceEnd;
+			instance++;
+		}
+	});
+	if (degenerate > 0) {
+		std::cerr << "Warning: pos.w is 0.0f when transforming " << degenerate << " vertices." << std::endl;
+	}
+}
+
+int VertexCache::transformRange(const Model& model, const Mat4x4& modelViewProjection, uint base, int begin, int end){
+	if (begin >= end) {
+		return 0;
+	}
+	return projectPoints(modelViewProjection, &model.vertices[begin], end - begin, &x[base + begin], &y[base + begin], &z[base + begin], &w[base + begin]);
+}
+
+void VertexCache::gatherFace(const SceneInstance& instance, const Face& face, Vertex* vertices) const{
+	const Model& model = *instance.model;
+	for (int i = 0; i < 3; i++) {
+		const Face::VertexIndices& idx = face.vertices[i];
+		uint v = instance.vertexBase + idx.v;
+		vertices[i].position = Vec3f(x[v], y[v], z[v]);
+		vertices[i].worldPosition = model.vertices[idx.v];
+		vertices[i].normal = model.vNormals[idx.v];
+		if (instance.hasTransform) {
+			const Vec3f& p = vertices[i].worldPosition;
+			Vec4f world = instance.transform * Vec4f(p.x, p.y, p.z, 1.0f);
+			vertices[i].worldPosition = Vec3f(world.x, world.y, world.z);
+			// Renormalized so scaled instances shade like unscaled ones
+			Vec3f normal = instance.normalTransform * vertices[i].normal;
+			float length = normal.magnitude();
+			if (length > 0.0f) {
+				vertices[i].normal = normal / length;
+			}
+		}
+		vertices[i].texcoord = model.texcoords.empty() ? Vec2f() : model.texcoords[idx.vt];
+	}
+}
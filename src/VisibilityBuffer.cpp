@@ -0,0 +1,11 @@
+#include "VisibilityBuffer.h"
+#include <algorithm>
+
+VisibilityBuffer::VisibilityBuffer(int w, int h, DepthFormat format)
+	: SimpleZbuffer(w, h, format),
+	  triangleIds(w * h, NoTriangle) {}
+
+void VisibilityBuffer::clear(const Color& clearColor){
+	SimpleZbuffer::clear(clearColor);
+	std::fill(triangleIds.begin(), triangleIds.end(), NoTriangle);
+}
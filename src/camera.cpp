@@ -68,7 +68,13 @@ void Camera::getProjectionMatrix(Mat4x4 &matrix) const {
 
     matrix.m[0][0] = 1.0f / (tanHalfFOV * aspectRatio);
     matrix.m[1][1] = 1.0f / tanHalfFOV;
-    matrix.m[2][2] = (-nearPlane - farPlane) / zRange;
-    matrix.m[2][3] = 2.0f * farPlane * nearPlane / zRange;
+    if (reversedZ) {
+        // z_ndc = n (f - d) / (d (f - n)) at view distance d
+        matrix.m[2][2] = nearPlane / zRange;
+        matrix.m[2][3] = farPlane * nearPlane / zRange;
+    } else {
+        matrix.m[2][2] = (-nearPlane - farPlane) / zRange;
+        matrix.m[2][3] = 2.0f * farPlane * nearPlane / zRange;
+    }
     matrix.m[3][2] = 1.0f;
 }
@@ -0,0 +1,80 @@
+#include "camerapath.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+CameraPath CameraPath::orbit(const Camera& start) {
+    CameraPath path;
+    path.isOrbit = true;
+    path.orbitCenter = start.target;
+    path.orbitOffset = start.position - start.target;
+    path.orbitAxis = start.up.magnitude() > 0.0f ? start.up.normalized() : Vec3f(0.0f, 1.0f, 0.0f);
+    return path;
+}
+
+bool CameraPath::loadKeyframes(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open camera path: " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<Keyframe> loaded;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        Keyframe key;
+        if (!(iss >> key.position.x)) {
+            continue; // blank or comment-only line
+        }
+        if (!(iss >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z)) {
+            std::cerr << "Malformed keyframe at " << filename << ":" << lineNumber << std::endl;
+            return false;
+        }
+        loaded.push_back(key);
+    }
+    if (loaded.empty()) {
+        std::cerr << "Camera path has no keyframes: " << filename << std::endl;
+        return false;
+    }
+
+    isOrbit = false;
+    keyframes = std::move(loaded);
+    return true;
+}
+
+void CameraPath::apply(Camera& camera, int frame, int frameCount) const {
+    if (isOrbit) {
+        // Rodrigues rotation of the offset about the axis; the last frame stops one
+        // step short of the first so the turntable loops seamlessly
+        float angle = 2.0f * static_cast<float>(M_PI) * frame / std::max(frameCount, 1);
+        float c = std::cos(angle), s = std::sin(angle);
+        const Vec3f& k = orbitAxis;
+        const Vec3f& v = orbitOffset;
+        Vec3f rotated = v * c + k.cross(v) * s + k * (k.dot(v) * (1.0f - c));
+        camera.position = orbitCenter + rotated;
+        camera.target = orbitCenter;
+        return;
+    }
+    if (keyframes.empty()) {
+        return;
+    }
+    if (keyframes.size() == 1 || frameCount <= 1) {
+        camera.position = keyframes[0].position;
+        camera.target = keyframes[0].target;
+        return;
+    }
+
+    float t = float(frame) / (frameCount - 1) * (keyframes.size() - 1);
+    size_t segment = std::min(static_cast<size_t>(t), keyframes.size() - 2);
+    float f = t - segment;
+    const Keyframe& a = keyframes[segment];
+    const Keyframe& b = keyframes[segment + 1];
+    camera.position = a.position + (b.position - a.position) * f;
+    camera.target = a.target + (b.target - a.target) * f;
+}
@@ -0,0 +1,108 @@
+#include "culling.h"
+#include "parallel.h"
+
+void Culler::setup(const Camera& camera, const Mat4x4& projectionMatrix){
+	// The camera looks down -z in view space
+	Vec4f nearPoint = projectionMatrix * Vec4f(0.0f, 0.0f, -camera.nearPlane, 1.0f);
+	Vec4f farPoint = projectionMatrix * Vec4f(0.0f, 0.0f, -camera.farPlane, 1.0f);
+	nearDepth = nearPoint.z / nearPoint.w;
+	farDepth = farPoint.z / farPoint.w;
+	frontW = nearPoint.w < 0.0f ? -1.0f : 1.0f;
+}
+
+uint8_t Culler::outcode(const Vec4f& clip) const{
+	if (!(clip.w * frontW > 0.0f))
+		return OutNear;
+	return outcode(clip.x / clip.w, clip.y / clip.w, clip.z / clip.w, clip.w);
+}
+
+uint8_t Culler::outcode(float x, float y, float z, float w) const{
+	if (!(w * frontW > 0.0f))
+		return OutNear;
+
+	uint8_t code = 0;
+	float t = (z - nearDepth) / (farDepth - nearDepth);
+	if (x < -1.0f) code |= OutLeft;
+	if (x > 1.0f) code |= OutRight;
+	if (y < -1.0f) code |= OutBottom;
+	if (y > 1.0f) code |= OutTop;
+	if (t < 0.0f) code |= OutNear;
+	if (t > 1.0f) code |= OutFar;
+	return code;
+}
+
+int Culler::classify(const Vec3f& p0, const Vec3f& p1, const Vec3f& p2, uint8_t code0, uint8_t code1, uint8_t code2,
+					 bool flipsWinding) const{
+	if ((mode & CullFrustum) && (code0 & code1 & code2))
+		return CullFrustum;
+
+	if ((mode & CullBackFaces) && !((code0 | code1 | code2) & OutNear)) {
+		// Counter-clockwise in NDC faces the camera; the divide by a negative w
+		// rotates x and y by 180 degrees, which keeps the winding
+		float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+		if (flipsWinding)
+			area = -area;
+		if (!(area > 0.0f))
+			return CullBackFaces;
+	}
+	return CullNone;
+}
+
+void Culler::run(const Scene& scene, const VertexCache& cache, int threads){
+	const uint BlockSize = 4096;
+	uint vertexCount = scene.vertexCount();
+	uint faceCount = scene.faceCount();
+	outcodes.resize(vertexCount);
+	faceResult.resize(faceCount);
+	visibleFaces.clear();
+	stats = CullStats();
+	stats.submitted = faceCount;
+
+	if (mode == CullNone) {
+		visibleFaces.resize(faceCount);
+		for (uint faceIter = 0; faceIter < faceCount; faceIter++) {
+			visibleFaces[faceIter] = faceIter;
+		}
+		return;
+	}
+
+	// The cache already holds every vertex projected, so no transform is repeated here
+	parallelFor((vertexCount + BlockSize - 1) / BlockSize, threads, [&](int block) {
+		uint end = std::min(block * BlockSize + BlockSize, vertexCount);
+		for (uint i = block * BlockSize; i < end; i++) {
+			outcodes[i] = outcode(cache.x[i], cache.y[i], cache.z[i], cache.w[i]);
+		}
+	});
+
+	parallelFor((faceCount + BlockSize - 1) / BlockSize, threads, [&](int block) {
+		uint end = std::min(block * BlockSize + BlockSize, faceCount);
+		int instance = scene.instanceOfFace(block * BlockSize);
+		for (uint faceIter = block * BlockSize; faceIter < end; faceIter++) {
+			instance = scene.instanceOfFace(faceIter, instance);
+			const SceneInstance& inst = scene.instances[instance];
+			const Face& face = inst.model->faces[faceIter - inst.faceBase];
+			uint a = inst.vertexBase + face.vertices[0].v;
+			uint b = inst.vertexBase + face.vertices[1].v;
+			uint c = inst.vertexBase + face.vertices[2].v;
+			faceResult[faceIter] = classify(Vec3f(cache.x[a], cache.y[a], cache.z[a]),
+											Vec3f(cache.x[b], cache.y[b], cache.z[b]),
+											Vec3f(cache.x[c], cache.y[c], cache.z[c]),
+											outcodes[a], outcodes[b], outcodes[c], inst.flipsWinding);
+		}
+	});
+
+	visibleFaces.reserve(faceCount);
+	for (uint faceIter = 0; faceIter < faceCount; faceIter++) {
+		switch (faceResult[faceIter]) {
+		case CullNone:
+			visibleFaces.push_back(faceIter);
+			break;
+		case CullBackFaces:
+			stats.backFacing++;
+			break;
+		default:
+			stats.outsideFrustum++;
+			break;
+		}
+	}
+}
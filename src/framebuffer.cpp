@@ -1,7 +1,15 @@
 #include "framebuffer.h"
-#include <fstream>
 #include <iostream>
-#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 Framebuffer::Framebuffer(int w, int h)
     : width(w), height(h),
@@ -12,90 +20,151 @@ void Framebuffer::clear(const Color& clearColor) {
     std::fill(colorBuffer.begin(), colorBuffer.end(), clearColor);
 }
 
-// Simple BMP writer
+// Writes every byte described by iov, resuming after partial writes.
+static bool writeAll(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, std::min(count, IOV_MAX));
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        while (count > 0 && size_t(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+// Simple BMP writer. Color is stored as BGR, so each row of colorBuffer is
+// already BMP pixel data: the file is gathered straight from the buffer with
+// writev, bottom row first, with no per-pixel conversion.
 void Framebuffer::saveToBMP(const std::string& filename) const {
-    std::ofstream ofs(filename, std::ios::binary);
-    if (!ofs) {
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
         std::cerr << "Failed to open file for writing: " << filename << std::endl;
         return;
     }
 
-    // BMP Header
-    uint16_t bfType = 0x4D42; // 'BM'
-    uint32_t bfSize = 54 + 3 * width * height;
-    uint32_t bfReserved = 0;
-    uint32_t bfOffBits = 54;
+    uint32_t rowSize = 3 * width;
+    uint32_t padding = (4 - rowSize % 4) % 4;
+    uint32_t imageSize = (rowSize + padding) * height;
 
-    // DIB Header
-    uint32_t biSize = 40;
-    int32_t biWidth = width;
-    int32_t biHeight = height;
-    uint16_t biPlanes = 1;
-    uint16_t biBitCount = 24;
-    uint32_t biCompression = 0;
-    uint32_t biSizeImage = 3 * width * height;
-    int32_t biXPelsPerMeter = 0;
-    int32_t biYPelsPerMeter = 0;
-    uint32_t biClrUsed = 0;
-    uint32_t biClrImportant = 0;
-
-    // Write BMP Header
-    ofs.write(reinterpret_cast<const char*>(&bfType), sizeof(bfType));
-    ofs.write(reinterpret_cast<const char*>(&bfSize), sizeof(bfSize));
-    ofs.write(reinterpret_cast<const char*>(&bfReserved), sizeof(bfReserved));
-    ofs.write(reinterpret_cast<const char*>(&bfOffBits), sizeof(bfOffBits));
-
-    // Write DIB Header
-    ofs.write(reinterpret_cast<const char*>(&biSize), sizeof(biSize));
-    ofs.write(reinterpret_cast<const char*>(&biWidth), sizeof(biWidth));
-    ofs.write(reinterpret_cast<const char*>(&biHeight), sizeof(biHeight));
-    ofs.write(reinterpret_cast<const char*>(&biPlanes), sizeof(biPlanes));
-    ofs.write(reinterpret_cast<const char*>(&biBitCount), sizeof(biBitCount));
-    ofs.write(reinterpret_cast<const char*>(&biCompression), sizeof(biCompression));
-    ofs.write(reinterpret_cast<const char*>(&biSizeImage), sizeof(biSizeImage));
-    ofs.write(reinterpret_cast<const char*>(&biXPelsPerMeter), sizeof(biXPelsPerMeter));
-    ofs.write(reinterpret_cast<const char*>(&biYPelsPerMeter), sizeof(biYPelsPerMeter));
-    ofs.write(reinterpret_cast<const char*>(&biClrUsed), sizeof(biClrUsed));
-    ofs.write(reinterpret_cast<const char*>(&biClrImportant), sizeof(biClrImportant));
+    // BMP Header (14 bytes) followed by DIB Header (40 bytes), little-endian
+    unsigned char header[54] = {};
+    auto put16 = [&header](int offset, uint16_t value) {
+        header[offset] = value & 0xFF;
+        header[offset + 1] = value >> 8;
+    };
+    auto put32 = [&header](int offset, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            header[offset + i] = (value >> (8 * i)) & 0xFF;
+        }
+    };
+    put16(0, 0x4D42);           // bfType 'BM'
+    put32(2, 54 + imageSize);   // bfSize
+    put32(10, 54);              // bfOffBits
+    put32(14, 40);              // biSize
+    put32(18, width);           // biWidth
+    put32(22, height);          // biHeight, positive: rows stored bottom-up
+    put16(26, 1);               // biPlanes
+    put16(28, 24);              // biBitCount
+    put32(34, imageSize);       // biSizeImage
 
-    // Write Pixel Data (BMP stores pixels bottom-up)
+    // Header, then one entry per row (plus its padding), bottom row first
+    static const char zeros[4] = {};
+    std::vector<struct iovec>& iov = bmpIov;
+    iov.clear();
+    iov.reserve(1 + 2 * height);
+    iov.push_back({ header, sizeof(header) });
     for (int y = height - 1; y >= 0; --y) {
-        for (int x = 0; x < width; ++x) {
-            const Color& color = colorBuffer[y * width + x];
-            ofs.put(static_cast<char>(color.b));
-            ofs.put(static_cast<char>(color.g));
-            ofs.put(static_cast<char>(color.r));
-        }
-        // Padding for 4-byte alignment
-        int padding = (4 - (width * 3) % 4) % 4;
-        for (int p = 0; p < padding; ++p) {
-            ofs.put(0);
+        iov.push_back({ const_cast<Color*>(&colorBuffer[y * width]), rowSize });
+        if (padding) {
+            iov.push_back({ const_cast<char*>(zeros), padding });
         }
     }
 
-    ofs.close();
+    bool ok = writeAll(fd, iov.data(), iov.size());
+    ok = ::close(fd) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Failed to write image: " << filename << std::endl;
+        return;
+    }
     std::cout << "Image saved to " << filename << std::endl;
 }
 
-SimpleZbuffer::SimpleZbuffer(int w, int h)
+SimpleZbuffer::SimpleZbuffer(int w, int h, DepthFormat format)
     : Framebuffer(w, h),
-      depthBuffer(w * h, -std::numeric_limits<float>::infinity()) {}
+      depthFormat(format),
+      depthBuffer(format == DepthFloat32 ? w * h : 0, -std::numeric_limits<float>::infinity()),
+      depthBuffer16(format == DepthUnorm16 ? w * h : 0, 0),
+      depthBuffer24(format == DepthUnorm24 ? w * h : 0, 0),
+      tilesX((w + DepthTileSize - 1) / DepthTileSize),
+      tilesY((h + DepthTileSize - 1) / DepthTileSize),
+      depthTiles(tilesX * tilesY, DepthTile{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() }),
+      depthQuantumCount(format == DepthUnorm24 ? float((1 << 24) - 2) : 65534.0f) {}
 
 void SimpleZbuffer::clear(const Color& clearColor) {
     std::fill(colorBuffer.begin(), colorBuffer.end(), clearColor);
     std::fill(depthBuffer.begin(), depthBuffer.end(), -std::numeric_limits<float>::infinity());
+    std::fill(depthBuffer16.begin(), depthBuffer16.end(), 0);
+    std::fill(depthBuffer24.begin(), depthBuffer24.end(), 0);
+    std::fill(depthTiles.begin(), depthTiles.end(),
+              DepthTile{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() });
 }
 
-void SimpleZbuffer::setPixel(int x, int y, const Color& color, float depth) {
-    if (x < 0 || x >= width || y < 0 || y >= height)
-        return;
+void SimpleZbuffer::setDepthRange(float farDepth, float nearDepth) {
+    depthRangeFar = farDepth;
+    depthRangeScale = 1.0f / (nearDepth - farDepth);
+}
 
-    int index = y * width + x;
-    if (depth > depthBuffer[index]) {
-        depthBuffer[index] = depth;
-        colorBuffer[index] = color;
+float SimpleZbuffer::dequantizeDepth(uint32_t q) const {
+    if (q == 0) {
+        return -std::numeric_limits<float>::infinity();
     }
-    if(y == 733){
-        colorBuffer[index] = Color(0, 255, 0);
+    return depthRangeFar + float(double(q - 1) / depthQuantumCount / depthRangeScale);
+}
+
+void SimpleZbuffer::refreshTileFarthest(int tx, int ty) {
+    int x0 = tx * DepthTileSize, y0 = ty * DepthTileSize;
+    int x1 = std::min(x0 + DepthTileSize, width);
+    int y1 = std::min(y0 + DepthTileSize, height);
+    float farthest = std::numeric_limits<float>::infinity();
+    if (depthFormat != DepthFloat32) {
+        // Quantization is monotonic, so the smallest stored value is the farthest
+        uint32_t smallest = ~0u;
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                uint32_t q = depthFormat == DepthUnorm16 ? depthBuffer16[y * width + x] : depthBuffer24[y * width + x];
+                smallest = std::min(smallest, q);
+            }
+        }
+        depthTiles[ty * tilesX + tx].farthest = dequantizeDepth(smallest);
+        return;
+    }
+#ifdef __AVX2__
+    if (x1 - x0 == DepthTileSize) {
+        __m256 rowMin = _mm256_set1_ps(farthest);
+        for (int y = y0; y < y1; y++) {
+            rowMin = _mm256_min_ps(rowMin, _mm256_loadu_ps(&depthBuffer[y * width + x0]));
+        }
+        __m128 m = _mm_min_ps(_mm256_castps256_ps128(rowMin), _mm256_extractf128_ps(rowMin, 1));
+        m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+        depthTiles[ty * tilesX + tx].farthest = _mm_cvtss_f32(m);
+        return;
+    }
+#endif
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            farthest = std::min(farthest, depthBuffer[y * width + x]);
+        }
     }
+    depthTiles[ty * tilesX + tx].farthest = farthest;
 }
@@ -1,32 +1,161 @@
 #include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "Timer.h"
 #include "model.h"
 #include "shader.h"
 #include "camera.h"
+#include "camerapath.h"
+#include "scene.h"
 #include "light.h"
 #include "renderer.h"
 
 int main(int argc, char** argv) {
+    // Options may appear anywhere; the remaining arguments are positional
+    std::string statsFile;
+    std::string pathName = "orbit";
+    int frameCount = 1;
+    int instanceCount = 1;
+    bool specular = false;
+    bool reversedZ = false;
+    bool lods = false;
+    DepthFormat depthFormat = DepthFloat32;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stats" && i + 1 < argc) {
+            statsFile = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frameCount = std::atoi(argv[++i]);
+            if (frameCount < 1) {
+                std::cerr << "Frame count must be at least 1" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--instances" && i + 1 < argc) {
+            instanceCount = std::atoi(argv[++i]);
+            if (instanceCount < 1) {
+                std::cerr << "Instance count must be at least 1" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--path" && i + 1 < argc) {
+            pathName = argv[++i];
+        } else if (arg == "--specular") {
+            specular = true;
+        } else if (arg == "--depth" && i + 1 < argc) {
+            std::string formatName = argv[++i];
+            if (formatName == "float") {
+                depthFormat = DepthFloat32;
+            } else if (formatName == "unorm16") {
+                depthFormat = DepthUnorm16;
+            } else if (formatName == "unorm24") {
+                depthFormat = DepthUnorm24;
+            } else {
+                std::cerr << "Unknown depth format: " << formatName << std::endl;
+                return 1;
+            }
+        } else if (arg == "--reversed-z") {
+            reversedZ = true;
+        } else if (arg == "--lod") {
+            lods = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = int(args.size());
+    argv = args.data();
+
     if (argc < 3) {
-        std::cerr << "Usage: project <path_to_obj_file> <output_image.bmp>" << std::endl;
+        std::cerr << "Usage: project <path_to_obj_or_mesh_file> <output_image.bmp> [simple|scanline|interval|hierarchical|octree|visibility] [all|backface|frustum|none]" << std::endl;
+        std::cerr << "       project <path_to_obj_file> <output.mesh>   (convert to the binary mesh format)" << std::endl;
+        std::cerr << "       --stats <file.json|file.csv>   write pipeline statistics for every frame" << std::endl;
+        std::cerr << "       --frames N [--path orbit|<keyframes.txt>]   render N frames along a camera path," << std::endl;
+        std::cerr << "                                                    saved as <output>_0000.bmp, ..." << std::endl;
+        std::cerr << "       --instances N   render N instances of the model on a grid, in one pass" << std::endl;
+        std::cerr << "       --specular   add the specular term to the lighting" << std::endl;
+        std::cerr << "       --depth float|unorm16|unorm24   depth buffer storage format" << std::endl;
+        std::cerr << "       --reversed-z   map the near plane to depth 1 and the far plane to 0" << std::endl;
+        std::cerr << "       --lod   simplify the model into levels of detail, picked per instance by screen size" << std::endl;
         return 1;
     }
 
     std::string objFile = argv[1];
     std::string outputImage = argv[2];
+
+    Renderer::ZBufferMethod method = Renderer::ZBufferMethod::ScanLine;
+    if (argc > 3) {
+        std::string methodName = argv[3];
+        if (methodName == "simple") {
+            method = Renderer::ZBufferMethod::Simple;
+        } else if (methodName == "scanline") {
+            method = Renderer::ZBufferMethod::ScanLine;
+        } else if (methodName == "interval") {
+            method = Renderer::ZBufferMethod::IntervalScanLine;
+        } else if (methodName == "hierarchical") {
+            method = Renderer::ZBufferMethod::SimpleHierarchical;
+        } else if (methodName == "octree") {
+            method = Renderer::ZBufferMethod::OctreeHierarchical;
+        } else if (methodName == "visibility") {
+            method = Renderer::ZBufferMethod::VisibilityBuffer;
+        } else {
+            std::cerr << "Unknown z-buffer method: " << methodName << std::endl;
+            return 1;
+        }
+    }
+    int cullMode = CullAll;
+    if (argc > 4) {
+        std::string cullName = argv[4];
+        if (cullName == "all") {
+            cullMode = CullAll;
+        } else if (cullName == "backface") {
+            cullMode = CullBackFaces;
+        } else if (cullName == "frustum") {
+            cullMode = CullFrustum;
+        } else if (cullName == "none") {
+            cullMode = CullNone;
+        } else {
+            std::cerr << "Unknown cull mode: " << cullName << std::endl;
+            return 1;
+        }
+    }
+    auto hasExtension = [](const std::string& name, const std::string& ext) {
+        return name.size() >= ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
+    };
+
     Model model;
 
-    if (!model.loadFromOBJ(objFile)) {
-        std::cerr << "Failed to load OBJ file." << std::endl;
-        return 1;
+    if (hasExtension(objFile, ".mesh")) {
+        // Already normalized and with normals when it was exported
+        if (!model.loadFromMesh(objFile)) {
+            std::cerr << "Failed to load mesh file." << std::endl;
+            return 1;
+        }
+    } else {
+        if (!model.loadFromOBJ(objFile)) {
+            std::cerr << "Failed to load OBJ file." << std::endl;
+            return 1;
+        }
+        model.normalizeToUnitCube();
+    }
+
+    if (hasExtension(outputImage, ".mesh")) {
+        return model.saveToMesh(outputImage) ? 0 : 1;
+    }
+    if (lods) {
+        model.buildLods();
     }
-    model.normalizeToUnitCube();
 
-    // Model model2; 
-    // if (!model2.loadFromOBJ("../bunny.obj")) {
-    //     std::cerr << "Failed to load OBJ file." << std::endl;
-    //     return 1;
-    // }
-    // model2.normalizeToUnitCube();
+    // Instances share the model's geometry; each gets its own grid cell and turn
+    Scene scene;
+    int gridSide = int(std::ceil(std::sqrt(double(instanceCount))));
+    const float spacing = 2.5f;
+    for (int i = 0; i < instanceCount; i++) {
+        Vec3f cell((i % gridSide - (gridSide - 1) * 0.5f) * spacing, 0.0f, (i / gridSide - (gridSide - 1) * 0.5f) * spacing);
+        Mat4x4 transform = Mat4x4::translation(model.center + cell) * Mat4x4::rotationY(0.7f * i) * Mat4x4::translation(-model.center);
+        scene.add(model, instanceCount == 1 ? Mat4x4::identity() : transform);
+    }
 
     // Define light
     Light light(Vec3f(-1.0f, -1.0f, -1.0f), Vec3f(1.0f, 1.0f, 1.0f));
@@ -37,10 +166,13 @@ int main(int argc, char** argv) {
                   Vec3f(0.5f, 0.5f, 0.5f), // Diffuse
                   Vec3f(0.7f, 0.7f, 0.7f), // Specular
                   16.0f);                  // Shininess
+    if (specular) {
+        shader.features |= ShadeSpecular;
+    }
 
     // Define camera
     Camera camera(
-        Vec3f(1.5f, 2.5f, 3.5f), // Position
+        model.center + (Vec3f(1.5f, 2.5f, 3.5f) - model.center) * float(gridSide), // Position, backed off to fit the grid
         model.center, // Target
         Vec3f(0.0f, 1.0f, 0.0f), // Up vector
         60.0f,                    // FOV
@@ -48,21 +180,80 @@ int main(int argc, char** argv) {
         0.1f,                     // Near plane
         100.0f                    // Far plane
     );
+    camera.reversedZ = reversedZ;
 
     // Define renderer with desired image size
     int width = 2400;
     int height = 1800;
-    Renderer renderer(width, height, shader, camera);
+    Renderer renderer(width, height, shader, camera, method, depthFormat);
+    renderer.cullMode = cullMode;
+    renderer.useLods = lods;
+    renderer.collectStats = !statsFile.empty();
 
-    // Render the model
-    renderer.framebuffer->clear(Color(0.1, 0.1, 0.1));
-    renderer.render(model);
-    // renderer.render(model2);
+    CameraPath path = CameraPath::orbit(camera);
+    if (pathName != "orbit" && !path.loadKeyframes(pathName)) {
+        return 1;
+    }
+
+    std::ofstream statsStream;
+    bool statsJson = hasExtension(statsFile, ".json");
+    if (!statsFile.empty()) {
+        statsStream.open(statsFile);
+        if (!statsStream) {
+            std::cerr << "Failed to open stats file: " << statsFile << std::endl;
+            return 1;
+        }
+        if (!statsJson) {
+            FrameStats::writeCsvHeader(statsStream);
+        }
+    }
+
+    // Every frame reuses the renderer, so buffers and tables keep their capacity
+    std::string frameImage = outputImage;
+    size_t extension = outputImage.rfind('.');
+    if (extension == std::string::npos) {
+        extension = outputImage.size();
+    }
+    for (int frame = 0; frame < frameCount; frame++) {
+        if (frameCount > 1) {
+            path.apply(renderer.camera, frame, frameCount);
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), "_%04d", frame);
+            frameImage.assign(outputImage, 0, extension);
+            frameImage.append(suffix);
+            frameImage.append(outputImage, extension, std::string::npos);
+        }
 
-    // Save the framebuffer to an image
-    renderer.framebuffer->saveToBMP(outputImage);
+        // Render the model
+        renderer.framebuffer->clear(Color(0.1, 0.1, 0.1));
+        renderer.render(scene);
 
-    std::cout << "Rendering complete. Image saved to " << outputImage << std::endl;
+        // Save the framebuffer to an image
+        Timer writeTimer;
+        writeTimer.start();
+        renderer.framebuffer->saveToBMP(frameImage);
+        writeTimer.stop();
+        renderer.frameStats.stageSeconds[StageWrite] = writeTimer.elapsed();
+
+        if (statsStream.is_open()) {
+            // JSON output holds one object per line, one line per frame
+            if (statsJson) {
+                renderer.frameStats.writeJson(statsStream);
+                statsStream << "\n";
+            } else {
+                renderer.frameStats.writeCsvRow(statsStream);
+            }
+        }
+    }
+    if (statsStream.is_open()) {
+        std::cout << "Pipeline statistics written to " << statsFile << std::endl;
+    }
+
+    if (frameCount > 1) {
+        std::cout << "Rendering complete. " << frameCount << " frames saved." << std::endl;
+    } else {
+        std::cout << "Rendering complete. Image saved to " << outputImage << std::endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,152 @@
+#include "model.h"
+#include "meshfile.h"
+#include "mappedfile.h"
+#include "Timer.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+static_assert(sizeof(Vec3f) == 3 * sizeof(float), "Vec3f sections are stored as packed floats");
+static_assert(sizeof(Vec2f) == 2 * sizeof(float), "Vec2f sections are stored as packed floats");
+static_assert(sizeof(Face) == 9 * sizeof(int), "Face sections are stored as packed indices");
+
+namespace {
+
+uint64_t alignSection(uint64_t offset) {
+    return (offset + MeshFileAlignment - 1) / MeshFileAlignment * MeshFileAlignment;
+}
+
+// Element size of each section, in MeshFileSectionId order
+const uint64_t SectionElementSize[MeshSectionCount] = {
+    sizeof(Vec3f), sizeof(Vec3f), sizeof(Vec3f), sizeof(Vec2f), sizeof(Face)
+};
+
+} // namespace
+
+bool Model::saveToMesh(const std::string& filename) const {
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "Failed to open file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    const void* sectionData[MeshSectionCount] = {
+        vertices.data(), vNormals.data(), fNormals.data(), texcoords.data(), faces.data()
+    };
+    const uint64_t sectionCount[MeshSectionCount] = {
+        vertices.size(), vNormals.size(), fNormals.size(), texcoords.size(), faces.size()
+    };
+
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MeshFileMagic, sizeof(header.magic));
+    header.version = MeshFileVersion;
+    header.byteOrder = MeshFileByteOrder;
+    uint64_t offset = alignSection(sizeof(MeshFileHeader));
+    for (int i = 0; i < MeshSectionCount; i++) {
+        header.sections[i].offset = offset;
+        header.sections[i].count = sectionCount[i];
+        offset = alignSection(offset + sectionCount[i] * SectionElementSize[i]);
+    }
+    const Vec3f* corners[3] = { &bbox.min, &bbox.max, &center };
+    float* targets[3] = { header.bboxMin, header.bboxMax, header.center };
+    for (int i = 0; i < 3; i++) {
+        targets[i][0] = corners[i]->x;
+        targets[i][1] = corners[i]->y;
+        targets[i][2] = corners[i]->z;
+    }
+
+    // One write per section plus the zero padding in front of it
+    const char padding[MeshFileAlignment] = {};
+    uint64_t written = sizeof(header);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int i = 0; i < MeshSectionCount; i++) {
+        ofs.write(padding, header.sections[i].offset - written);
+        uint64_t bytes = sectionCount[i] * SectionElementSize[i];
+        if (bytes > 0) {
+            ofs.write(static_cast<const char*>(sectionData[i]), bytes);
+        }
+        written = header.sections[i].offset + bytes;
+    }
+    ofs.write(padding, offset - written);
+
+    if (!ofs) {
+        std::cerr << "Failed to write mesh file: " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Mesh saved to " << filename << std::endl;
+    return true;
+}
+
+bool Model::loadFromMesh(const std::string& filename) {
+    Timer timer;
+    timer.start();
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) {
+        std::cerr << "Failed to open mesh file: " << filename << std::endl;
+        return false;
+    }
+
+    MeshFileHeader header;
+    if (file->size() < sizeof(header)) {
+        std::cerr << "Mesh file is truncated: " << filename << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, MeshFileMagic, sizeof(header.magic)) != 0) {
+        std::cerr << "Not a mesh file: " << filename << std::endl;
+        return false;
+    }
+    if (header.version != MeshFileVersion || header.byteOrder != MeshFileByteOrder) {
+        std::cerr << "Unsupported mesh file version or byte order: " << filename << std::endl;
+        return false;
+    }
+    for (int i = 0; i < MeshSectionCount; i++) {
+        const MeshFileSection& section = header.sections[i];
+        if (section.offset % MeshFileAlignment != 0 || section.offset > file->size() ||
+            section.count > (file->size() - section.offset) / SectionElementSize[i]) {
+            std::cerr << "Mesh file section out of bounds: " << filename << std::endl;
+            return false;
+        }
+    }
+
+    auto section = [&](MeshFileSectionId id) {
+        return file->data() + header.sections[id].offset;
+    };
+    // Renderers index these arrays without checks, so the counts and face indices
+    // must agree before the file is used
+    uint64_t vertexCount = header.sections[MeshVertices].count;
+    uint64_t texcoordCount = header.sections[MeshTexcoords].count;
+    uint64_t faceCount = header.sections[MeshFaces].count;
+    if (header.sections[MeshVNormals].count != vertexCount || header.sections[MeshFNormals].count != faceCount) {
+        std::cerr << "Mesh file normal counts do not match its vertices and faces: " << filename << std::endl;
+        return false;
+    }
+    const Face* fileFaces = reinterpret_cast<const Face*>(section(MeshFaces));
+    for (uint64_t f = 0; f < faceCount; f++) {
+        for (const Face::VertexIndices& corner : fileFaces[f].vertices) {
+            if (uint32_t(corner.v) >= vertexCount || (texcoordCount > 0 && uint32_t(corner.vt) >= texcoordCount)) {
+                std::cerr << "Mesh file face " << f << " indexes past the vertex or texcoord data: " << filename << std::endl;
+                return false;
+            }
+        }
+    }
+    vertices.setView(reinterpret_cast<const Vec3f*>(section(MeshVertices)), header.sections[MeshVertices].count);
+    vNormals.setView(reinterpret_cast<const Vec3f*>(section(MeshVNormals)), header.sections[MeshVNormals].count);
+    fNormals.setView(reinterpret_cast<const Vec3f*>(section(MeshFNormals)), header.sections[MeshFNormals].count);
+    texcoords.setView(reinterpret_cast<const Vec2f*>(section(MeshTexcoords)), header.sections[MeshTexcoords].count);
+    faces.setView(reinterpret_cast<const Face*>(section(MeshFaces)), header.sections[MeshFaces].count);
+    // Only needed to derive vNormals, which are stored directly
+    normals.clear();
+
+    bbox.min = Vec3f(header.bboxMin[0], header.bboxMin[1], header.bboxMin[2]);
+    bbox.max = Vec3f(header.bboxMax[0], header.bboxMax[1], header.bboxMax[2]);
+    center = Vec3f(header.center[0], header.center[1], header.center[2]);
+    meshFile = std::move(file);
+
+    std::cout << "Total vertices mapped: " << vertices.size() << std::endl;
+    std::cout << "Total faces mapped: " << faces.size() << std::endl;
+    loadTime = timer.elapsed();
+    normalsTime = 0.0;
+    return true;
+}
@@ -1,8 +1,12 @@
 #include "model.h"
-#include <fstream>
-#include <sstream>
+#include "simplify.h"
+#include "mappedfile.h"
+#include "parallel.h"
+#include "Timer.h"
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <cstdint>
 
 // BoundingBox Implementation
 
@@ -36,118 +40,310 @@ Model::~Model() {
     // Destructor implementation (if needed)
 }
 
-bool Model::loadFromOBJ(const std::string& filename) {
-    std::ifstream infile(filename);
-    if (!infile.is_open()) {
-        std::cerr << "Failed to open OBJ file: " << filename << std::endl;
-        return false;
+// OBJ parsing
+//
+// The file is memory-mapped and split into chunks at line boundaries. Chunks are
+// parsed in parallel into their own arrays and then appended in file order.
+// Positive indices are absolute and resolve on the spot. Negative indices count
+// back from the current end of an array, so a chunk resolves them against its
+// own counts and records a fixup; the merge then adds the counts of all earlier
+// chunks.
+
+namespace {
+
+struct ObjChunk {
+    struct Fixup {
+        int face;      // index into faces
+        int corner;    // 0..2
+        int component; // 0: v, 1: vt, 2: vn
+    };
+
+    std::vector<Vec3f> vertices;
+    std::vector<Vec2f> texcoords;
+    std::vector<Vec3f> normals;
+    std::vector<Face> faces;
+    std::vector<Fixup> fixups;
+    BoundingBox bbox;
+    int polygons = 0;     // faces with more than 3 corners, fan-triangulated
+    int degenerate = 0;   // faces with fewer than 3 corners, dropped
+
+    // Scratch for the corners of the face being parsed, reused across lines
+    std::vector<Face::VertexIndices> corners;
+    std::vector<uint8_t> cornerRelative; // bit per component set for relative indices
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlank(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) {
+        p++;
     }
+    return p;
+}
 
-    std::string line;
-    // Temporary variables for parsing
-    std::string prefix;
-    while (std::getline(infile, line)) {
-        // Remove carriage return character for Windows compatibility
-        // std::cout << "Parsing line: " << line << std::endl; // Debug statement
+// Parses an optionally signed decimal integer. Returns p unchanged if there are no digits.
+const char* parseInt(const char* p, const char* end, int& value) {
+    const char* begin = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    const char* digits = p;
+    int result = 0;
+    while (p < end && unsigned(*p - '0') < 10) {
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits) {
+        return begin;
+    }
+    value = negative ? -result : result;
+    return p;
+}
 
-        if(line.empty()) {
-            continue;
-        }
+// Parses a decimal float such as "-1.25e-3". Up to 19 significant digits are
+// accumulated exactly and scaled once by a power of ten. Returns p unchanged if
+// there are no digits.
+const char* parseFloat(const char* p, const char* end, float& value) {
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* begin = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
 
-        if (!line.empty() && line[line.size() - 1] == '\r') {
-            line.pop_back();
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; p < end && unsigned(*p - '0') < 10; p++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
         }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && unsigned(*p - '0') < 10; p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any) {
+        return begin;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        int e = 0;
+        const char* after = parseInt(p + 1, end, e);
+        if (after != p + 1) {
+            exponent += e;
+            p = after;
+        }
+    }
+
+    double result = double(mantissa);
+    if (exponent < 0) {
+        result = -exponent <= 22 ? result / powersOf10[-exponent] : result * std::pow(10.0, exponent);
+    } else if (exponent > 0) {
+        result = exponent <= 22 ? result * powersOf10[exponent] : result * std::pow(10.0, exponent);
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
 
-        std::istringstream iss(line);
-        iss >> prefix;
+// Parses up to `count` floats separated by blanks; missing values stay 0.
+void parseFloats(const char* p, const char* end, float* values, int count) {
+    for (int i = 0; i < count; i++) {
+        values[i] = 0.0f;
+        p = parseFloat(skipBlank(p, end), end, values[i]);
+    }
+}
 
-        if (prefix == "v") {
-            // Vertex position
-            float x, y, z;
-            iss >> x >> y >> z;
-            vertices.emplace_back(x, y, z);
-            // std::cout << "Parsed vertex: " << vertices.back() << std::endl; // Debug statement
-            bbox.update(Vec3f(x, y, z));
+// Resolves an OBJ index for one component of a corner. Absolute indices become
+// 0-based, relative ones become chunk-local and are flagged for the merge, and a
+// missing index (0) maps to 0.
+int resolveIndex(int index, int count, uint8_t& relative, int component) {
+    if (index > 0) {
+        return index - 1;
+    }
+    if (index < 0) {
+        relative |= 1 << component;
+        return count + index;
+    }
+    return 0;
+}
+
+void parseFace(const char* p, const char* end, ObjChunk& chunk) {
+    chunk.corners.clear();
+    chunk.cornerRelative.clear();
+    while (true) {
+        p = skipBlank(p, end);
+        int v = 0, vt = 0, vn = 0;
+        const char* next = parseInt(p, end, v);
+        if (next == p) {
+            break;
         }
-        else if (prefix == "vt") {
-            // Texture coordinate
-            float u, v;
-            iss >> u >> v;
-            texcoords.emplace_back(u, v);
-            // std::cout << "Parsed texcoord: " << texcoords.back() << std::endl; // Debug statement
+        p = next;
+        if (p < end && *p == '/') {
+            p = parseInt(p + 1, end, vt);
+            if (p < end && *p == '/') {
+                p = parseInt(p + 1, end, vn);
+            }
         }
-        else if (prefix == "vn") {
-            // Normal vector
-            float nx, ny, nz;
-            iss >> nx >> ny >> nz;
-            normals.emplace_back(nx, ny, nz);
-            // std::cout << "Parsed normal: " << normals.back() << std::endl; // Debug statement
+        // Skip anything else attached to the token
+        while (p < end && !isBlank(*p)) {
+            p++;
         }
-        else if (prefix == "f") {
-            // Face
-            Face face;
-            std::string vertexStr;
-            int vertexCount = 0;
-
-            while (iss >> vertexStr && vertexCount < 3) { // Assuming triangles
-                std::istringstream viss(vertexStr);
-                std::string vIdxStr, vtIdxStr, vnIdxStr;
-                int vIdx = 0, vtIdx = 0, vnIdx = 0;
-
-                // Parse the vertex string (e.g., "1/2/3")
-                size_t firstSlash = vertexStr.find('/');
-                size_t secondSlash = vertexStr.find('/', firstSlash + 1);
-
-                if (firstSlash == std::string::npos) {
-                    // Only vertex index is present
-                    vIdx = std::stoi(vertexStr);
-                }
-                else if (secondSlash == std::string::npos) {
-                    // Vertex and texture indices
-                    vIdxStr = vertexStr.substr(0, firstSlash);
-                    vtIdxStr = vertexStr.substr(firstSlash + 1);
-                    vIdx = std::stoi(vIdxStr);
-                    vtIdx = std::stoi(vtIdxStr);
-                }
-                else {
-                    // Vertex, texture, and normal indices
-                    vIdxStr = vertexStr.substr(0, firstSlash);
-                    vtIdxStr = vertexStr.substr(firstSlash + 1, secondSlash - firstSlash - 1);
-                    vnIdxStr = vertexStr.substr(secondSlash + 1);
-                    vIdx = std::stoi(vIdxStr);
-                    if (!vtIdxStr.empty()) {
-                        vtIdx = std::stoi(vtIdxStr);
-                    }
-                    if (!vnIdxStr.empty()) {
-                        vnIdx = std::stoi(vnIdxStr);
-                    }
-                }
 
-                // OBJ indices are 1-based, adjust to 0-based
-                face.vertices[vertexCount].v = (vIdx > 0) ? (vIdx - 1) : (vertices.size() + vIdx);
-                face.vertices[vertexCount].vt = (vtIdx > 0) ? (vtIdx - 1) : (texcoords.size() + vtIdx);
-                face.vertices[vertexCount].vn = (vnIdx > 0) ? (vnIdx - 1) : (normals.size() + vnIdx);
-                vertexCount++;
-            }
+        uint8_t relative = 0;
+        Face::VertexIndices corner;
+        corner.v = resolveIndex(v, chunk.vertices.size(), relative, 0);
+        corner.vt = resolveIndex(vt, chunk.texcoords.size(), relative, 1);
+        corner.vn = resolveIndex(vn, chunk.normals.size(), relative, 2);
+        chunk.corners.push_back(corner);
+        chunk.cornerRelative.push_back(relative);
+    }
 
-            if (vertexCount != 3) {
-                std::cerr << "Non-triangular face detected. Only triangles are supported." << std::endl;
-                // Optionally, implement triangulation for polygons with more vertices
-                continue;
+    int cornerCount = chunk.corners.size();
+    if (cornerCount < 3) {
+        chunk.degenerate++;
+        return;
+    }
+    if (cornerCount > 3) {
+        chunk.polygons++;
+    }
+
+    // Fan triangulation around the first corner
+    for (int i = 1; i + 1 < cornerCount; i++) {
+        const int fan[3] = { 0, i, i + 1 };
+        Face face;
+        for (int k = 0; k < 3; k++) {
+            int c = fan[k];
+            face.vertices[k] = chunk.corners[c];
+            for (int component = 0; component < 3; component++) {
+                if (chunk.cornerRelative[c] & (1 << component)) {
+                    chunk.fixups.push_back({ int(chunk.faces.size()), k, component });
+                }
             }
+        }
+        chunk.faces.push_back(face);
+    }
+}
 
-            faces.emplace_back(face);
+void parseChunk(const char* p, const char* end, ObjChunk& chunk) {
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        const char* q = skipBlank(p, lineEnd);
+        if (lineEnd - q >= 2) {
+            float values[3];
+            if (q[0] == 'v' && isBlank(q[1])) {
+                parseFloats(q + 2, lineEnd, values, 3);
+                chunk.vertices.emplace_back(values[0], values[1], values[2]);
+                chunk.bbox.update(chunk.vertices.back());
+            } else if (q[0] == 'v' && q[1] == 't' && lineEnd - q >= 3 && isBlank(q[2])) {
+                parseFloats(q + 3, lineEnd, values, 2);
+                chunk.texcoords.emplace_back(values[0], values[1]);
+            } else if (q[0] == 'v' && q[1] == 'n' && lineEnd - q >= 3 && isBlank(q[2])) {
+                parseFloats(q + 3, lineEnd, values, 3);
+                chunk.normals.emplace_back(values[0], values[1], values[2]);
+            } else if (q[0] == 'f' && isBlank(q[1])) {
+                parseFace(q + 2, lineEnd, chunk);
+            }
+            // Ignore other prefixes (e.g., "o", "g", "s", "usemtl", "#", etc.)
         }
-        // Ignore other prefixes (e.g., "o", "g", "s", "usemtl", etc.)
+        p = lineEnd + 1;
+    }
+}
+
+} // namespace
+
+bool Model::loadFromOBJ(const std::string& filename) {
+    Timer timer;
+    timer.start();
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Failed to open OBJ file: " << filename << std::endl;
+        return false;
+    }
+
+    // Chunks of at least 1 MiB, one per thread, each ending just after a newline
+    const size_t MinChunkSize = 1 << 20;
+    const char* data = file.data();
+    size_t size = file.size();
+    int chunkCount = std::max<size_t>(1, std::min<size_t>(defaultThreadCount(), size / MinChunkSize));
+    std::vector<size_t> bounds(chunkCount + 1, size);
+    bounds[0] = 0;
+    for (int i = 1; i < chunkCount; i++) {
+        size_t pos = std::max(bounds[i - 1], size / chunkCount * i);
+        const void* newline = pos < size ? memchr(data + pos, '\n', size - pos) : nullptr;
+        bounds[i] = newline ? static_cast<const char*>(newline) - data + 1 : size;
     }
 
-    infile.close();
+    std::vector<ObjChunk> chunks(chunkCount);
+    parallelFor(chunkCount, chunkCount, [&](int i) {
+        parseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+    });
+
+    // Merge in file order, shifting relative indices by the counts of earlier chunks
+    size_t vertexTotal = vertices.size(), texcoordTotal = texcoords.size(), normalTotal = normals.size(), faceTotal = faces.size();
+    for (const ObjChunk& chunk : chunks) {
+        vertexTotal += chunk.vertices.size();
+        texcoordTotal += chunk.texcoords.size();
+        normalTotal += chunk.normals.size();
+        faceTotal += chunk.faces.size();
+    }
+    vertices.reserve(vertexTotal);
+    texcoords.reserve(texcoordTotal);
+    normals.reserve(normalTotal);
+    faces.reserve(faceTotal);
+
+    int polygons = 0, degenerate = 0;
+    for (ObjChunk& chunk : chunks) {
+        const int offsets[3] = { int(vertices.size()), int(texcoords.size()), int(normals.size()) };
+        for (const ObjChunk::Fixup& fixup : chunk.fixups) {
+            Face::VertexIndices& corner = chunk.faces[fixup.face].vertices[fixup.corner];
+            int& index = fixup.component == 0 ? corner.v : fixup.component == 1 ? corner.vt : corner.vn;
+            index += offsets[fixup.component];
+        }
+        vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        faces.insert(faces.end(), chunk.faces.begin(), chunk.faces.end());
+        if (!chunk.vertices.empty()) {
+            bbox.update(chunk.bbox.min);
+            bbox.update(chunk.bbox.max);
+        }
+        polygons += chunk.polygons;
+        degenerate += chunk.degenerate;
+    }
 
+    if (polygons > 0) {
+        std::cout << "Triangulated polygon faces: " << polygons << std::endl;
+    }
+    if (degenerate > 0) {
+        std::cerr << "Skipped faces with fewer than 3 vertices: " << degenerate << std::endl;
+    }
     std::cout << "Total normals parsed: " << normals.size() << std::endl; // Debug statement
     std::cout << "Total vertices parsed: " << vertices.size() << std::endl; // Debug statement
     std::cout << "Total texcoords parsed: " << texcoords.size() << std::endl; // Debug statement
     std::cout << "Total faces parsed: " << faces.size() << std::endl; // Debug statement
 
+    loadTime = timer.elapsed();
     return true;
 }
 
@@ -197,6 +393,8 @@ void Model::normalizeToUnitCube() {
 }
 
 void Model::computeNormals(){
+    Timer timer;
+    timer.start();
     vNormals.resize(vertices.size(), Vec3f(0.0f, 0.0f, 0.0f));
     fNormals.resize(faces.size(), Vec3f(0.0f, 0.0f, 0.0f));
     std::vector<int> count(vertices.size(), 0);
@@ -269,4 +467,23 @@ void Model::computeNormals(){
             }
         }
     }
+    normalsTime = timer.elapsed();
+}
+
+void Model::buildLods(int levelCount, float ratio, int minFaces) {
+    lods.clear();
+    const Model* previous = this;
+    for (int level = 0; level < levelCount; level++) {
+        int target = int(previous->faces.size() * ratio);
+        if (target < minFaces) {
+            break;
+        }
+        auto lod = std::make_shared<Model>(simplifyModel(*previous, target));
+        if (lod->faces.size() >= previous->faces.size()) {
+            break; // no edge left that can be collapsed
+        }
+        std::cout << "LOD " << level + 1 << ": " << lod->faces.size() << " faces" << std::endl;
+        previous = lod.get();
+        lods.push_back(std::move(lod));
+    }
 }
@@ -0,0 +1,78 @@
+#include "octree.h"
+
+void Octree::build(const Model& model){
+	nodes.clear();
+
+	uint faces_size = model.faces.size();
+	std::vector<BoundingBox> faceBoxes(faces_size);
+	std::vector<int> faceIds(faces_size);
+	for (uint faceIter = 0; faceIter < faces_size; faceIter++) {
+		for (int i = 0; i < 3; i++) {
+			faceBoxes[faceIter].update(model.vertices[model.faces[faceIter].vertices[i].v]);
+		}
+		faceIds[faceIter] = faceIter;
+	}
+
+	OctreeNode root;
+	root.box = model.bbox;
+	nodes.push_back(root);
+	buildNode(0, faceIds, faceBoxes, 0);
+}
+
+void Octree::buildNode(int nodeId, const std::vector<int>& faceIds, const std::vector<BoundingBox>& faceBoxes, int depth){
+	for (int i = 0; i < 8; i++) {
+		nodes[nodeId].children[i] = -1;
+	}
+	nodes[nodeId].subtreeFaces = faceIds.size();
+
+	if (depth >= maxDepth || int(faceIds.size()) <= leafFaces) {
+		nodes[nodeId].faces = faceIds;
+		return;
+	}
+
+	BoundingBox box = nodes[nodeId].box;
+	Vec3f mid = (box.min + box.max) * 0.5f;
+
+	// octant bit 0: x, bit 1: y, bit 2: z; straddling faces stay at this node
+	std::vector<int> childFaces[8];
+	std::vector<int> ownFaces;
+	for (int faceId : faceIds) {
+		const BoundingBox& fb = faceBoxes[faceId];
+		int octant = 0;
+		bool straddles = false;
+		const float lo[3] = { fb.min.x, fb.min.y, fb.min.z };
+		const float hi[3] = { fb.max.x, fb.max.y, fb.max.z };
+		const float m[3] = { mid.x, mid.y, mid.z };
+		for (int axis = 0; axis < 3; axis++) {
+			if (lo[axis] >= m[axis]) {
+				octant |= 1 << axis;
+			} else if (hi[axis] > m[axis]) {
+				straddles = true;
+			}
+		}
+		if (straddles) {
+			ownFaces.push_back(faceId);
+		} else {
+			childFaces[octant].push_back(faceId);
+		}
+	}
+
+	if (ownFaces.size() == faceIds.size()) {
+		nodes[nodeId].faces = faceIds;
+		return;
+	}
+	nodes[nodeId].faces = std::move(ownFaces);
+
+	for (int octant = 0; octant < 8; octant++) {
+		if (childFaces[octant].empty()) {
+			continue;
+		}
+		OctreeNode child;
+		child.box.min = Vec3f(octant & 1 ? mid.x : box.min.x, octant & 2 ? mid.y : box.min.y, octant & 4 ? mid.z : box.min.z);
+		child.box.max = Vec3f(octant & 1 ? box.max.x : mid.x, octant & 2 ? box.max.y : mid.y, octant & 4 ? box.max.z : mid.z);
+		int childId = nodes.size();
+		nodes.push_back(child); // may reallocate, so only index nodes by id below
+		nodes[nodeId].children[octant] = childId;
+		buildNode(childId, childFaces[octant], faceBoxes, depth + 1);
+	}
+}
@@ -3,26 +3,154 @@
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <limits>
+#include "parallel.h"
+#include "Timer.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 
 // Constructor
-Renderer::Renderer(int w, int h, const Shader& shd, const Camera& cam)
-    : width(w), height(h), shader(shd), camera(cam) {
+Renderer::Renderer(int w, int h, const Shader& shd, const Camera& cam, ZBufferMethod method, DepthFormat depthFormat)
+    : width(w), height(h), shader(shd), camera(cam), zBufferMethod(method),
+      rasterThreads(defaultThreadCount()) {
         if(zBufferMethod == ZBufferMethod::Simple){
-            framebuffer = std::make_unique<SimpleZbuffer>(w, h);
+            framebuffer = std::make_unique<SimpleZbuffer>(w, h, depthFormat);
         }
-        else if (zBufferMethod == ZBufferMethod::ScanLine){
-            framebuffer = std::make_unique<ScanLineZBuffer>(w, h);
+        else if (zBufferMethod == ZBufferMethod::SimpleHierarchical || zBufferMethod == ZBufferMethod::OctreeHierarchical){
+            framebuffer = std::make_unique<HierarchicalZbuffer>(w, h, depthFormat);
+        }
+        else if (zBufferMethod == ZBufferMethod::ScanLine || zBufferMethod == ZBufferMethod::IntervalScanLine){
+            auto scanFB = std::make_unique<ScanLineZBuffer>(w, h);
+            scanFB->intervalScan = zBufferMethod == ZBufferMethod::IntervalScanLine;
+            framebuffer = std::move(scanFB);
             framebuffer->pRenderer = this;
         }
+        else if (zBufferMethod == ZBufferMethod::VisibilityBuffer){
+            framebuffer = std::make_unique<::VisibilityBuffer>(w, h, depthFormat);
+        }
     }
 
+const char* Renderer::methodName(ZBufferMethod method) {
+    switch (method) {
+    case ZBufferMethod::Simple: return "simple";
+    case ZBufferMethod::ScanLine: return "scanline";
+    case ZBufferMethod::SimpleHierarchical: return "hierarchical";
+    case ZBufferMethod::OctreeHierarchical: return "octree";
+    case ZBufferMethod::VisibilityBuffer: return "visibility";
+    case ZBufferMethod::IntervalScanLine: return "interval";
+    }
+    return "unknown";
+}
+
 void Renderer::render(const Model& model) {
+    singleScene.clear();
+    singleScene.add(model);
+    render(singleScene);
+}
+
+void Renderer::render(const Scene& scene) {
+    renderScene(useLods ? selectLods(scene) : scene);
+}
+
+const Scene& Renderer::selectLods(const Scene& scene) {
+    bool anyLods = false;
+    for (const SceneInstance& instance : scene.instances) {
+        anyLods |= !instance.model->lods.empty();
+    }
+    if (!anyLods) {
+        return scene;
+    }
+
+    Mat4x4 viewMatrix, projectionMatrix;
+    camera.getViewMatrix(viewMatrix);
+    camera.getProjectionMatrix(projectionMatrix);
+    Mat4x4 viewProjection = projectionMatrix * viewMatrix;
+    // Sign of w in front of the eye, as the culler works it out
+    float frontW = (projectionMatrix * Vec4f(0.0f, 0.0f, -camera.nearPlane, 1.0f)).w < 0.0f ? -1.0f : 1.0f;
+    lodScene.clear();
+    for (int i = 0; i < int(scene.instances.size()); i++) {
+        SceneInstance instance = scene.instances[i];
+        const Model& model = *instance.model;
+        if (!model.lods.empty()) {
+            // Screen rect of the world box; full detail once it reaches behind the eye
+            BoundingBox box = scene.bounds(i);
+            float x0 = std::numeric_limits<float>::max(), y0 = x0;
+            float x1 = std::numeric_limits<float>::lowest(), y1 = x1;
+            bool behind = false;
+            for (int corner = 0; corner < 8; corner++) {
+                Vec4f clip = viewProjection * Vec4f(corner & 1 ? box.max.x : box.min.x,
+                                                    corner & 2 ? box.max.y : box.min.y,
+                                                    corner & 4 ? box.max.z : box.min.z, 1.0f);
+                if (!(clip.w * frontW > 0.0f)) {
+                    behind = true;
+                    break;
+                }
+                float sx = (clip.x / clip.w + 1.0f) * 0.5f * width;
+                float sy = (clip.y / clip.w + 1.0f) * 0.5f * height;
+                x0 = std::min(x0, sx); x1 = std::max(x1, sx);
+                y0 = std::min(y0, sy); y1 = std::max(y1, sy);
+            }
+            if (!behind) {
+                float budget = (x1 - x0) * (y1 - y0) / lodPixelsPerTriangle;
+                const Model* chosen = model.lods.back().get();
+                if (model.faces.size() <= budget) {
+                    chosen = &model;
+                } else {
+                    for (const auto& lod : model.lods) {
+                        if (lod->faces.size() <= budget) {
+                            chosen = lod.get();
+                            break;
+                        }
+                    }
+                }
+                instance.model = chosen;
+            }
+        }
+        instance.vertexBase = lodScene.vertexCount();
+        instance.faceBase = lodScene.faceCount();
+        lodScene.instances.push_back(instance);
+    }
+    return lodScene;
+}
+
+void Renderer::renderScene(const Scene& scene) {
     // Clear framebuffer
     // framebuffer.clear(Color(0.1, 0.1, 0.1));
 
+    frameStats.reset();
+    frameStats.frame++;
+    frameStats.method = methodName(zBufferMethod);
+    frameStats.width = width;
+    frameStats.height = height;
+    frameStats.detailed = collectStats;
+    // Loading is a one-off cost, reported with the first frame of each model
+    for (const SceneInstance& instance : scene.instances) {
+        if (std::find(reportedModels.begin(), reportedModels.end(), instance.model) == reportedModels.end()) {
+            frameStats.stageSeconds[StageLoad] += instance.model->loadTime;
+            frameStats.stageSeconds[StageNormals] += instance.model->normalsTime;
+            reportedModels.push_back(instance.model);
+        }
+    }
+    if (scene.instances.empty()) {
+        return;
+    }
+    // Light direction and eye position are constant for the whole frame
+    shader.prepare(camera);
+    if (zBufferMethod != ZBufferMethod::ScanLine && zBufferMethod != ZBufferMethod::IntervalScanLine) {
+        // Compact depth formats quantize between the camera's near and far planes
+        Mat4x4 projectionMatrix;
+        camera.getProjectionMatrix(projectionMatrix);
+        Vec4f nearPoint = projectionMatrix * Vec4f(0.0f, 0.0f, -camera.nearPlane, 1.0f);
+        Vec4f farPoint = projectionMatrix * Vec4f(0.0f, 0.0f, -camera.farPlane, 1.0f);
+        static_cast<SimpleZbuffer*>(framebuffer.get())->setDepthRange(farPoint.z / farPoint.w, nearPoint.z / nearPoint.w);
+    }
+    Timer timer;
+
     // Get View and Projection matrices
-    if(this->zBufferMethod == ZBufferMethod::Simple){
+    if(this->zBufferMethod == ZBufferMethod::Simple || this->zBufferMethod == ZBufferMethod::SimpleHierarchical
+       || this->zBufferMethod == ZBufferMethod::VisibilityBuffer){
         Mat4x4 viewMatrix;
         camera.getViewMatrix(viewMatrix);
 
@@ -31,54 +159,477 @@ void Renderer::render(const Model& model) {
 
         std::cout << "projmat" << projectionMatrix; 
 
-        // Iterate over all faces
-        for (const auto& face : model.faces) {
-            std::vector<Vertex> vertices; 
-            vertices.resize(3);
-            for (int i = 0; i < 3; ++i) {
-                const Face::VertexIndices& idx = face.vertices[i];
-                vertices[i].position = model.vertices[idx.v];
-                vertices[i].normal = model.vNormals[idx.v];
-                vertices[i].texcoord = model.texcoords.empty() ? Vec2f() : model.texcoords[idx.vt];
-            }
-
-            // Transform vertices
-            for (int i = 0; i < 3; ++i) {
-                
-                Vec4f pos(vertices[i].position.x, vertices[i].position.y, vertices[i].position.z, 1.0f);
-                // World to View
-                pos = viewMatrix * pos; 
-                // View to Clip
-                pos = projectionMatrix * pos; 
-                if (pos.w != 0.0f) {
-                    vertices[i].position = Vec3f(pos.x / pos.w, pos.y / pos.w, pos.z / pos.w);
-                } else {
-                    std::cerr << "Warning: pos.w is 0.0f when transforming." << std::endl;;
+        // Every vertex is transformed once up front and shared by all its faces
+        Mat4x4 viewProjection = projectionMatrix * viewMatrix;
+        timer.start();
+        vertexCache.transform(scene, viewProjection, rasterThreads);
+        timer.stop();
+        frameStats.stageSeconds[StageTransform] = timer.elapsed();
+        cullFaces(scene, projectionMatrix);
+
+        if (this->zBufferMethod == ZBufferMethod::Simple) {
+            renderBinned(scene);
+        } else if (this->zBufferMethod == ZBufferMethod::VisibilityBuffer) {
+            // Ids only during rasterization; colors come from one pass over the final ids
+            renderBinned(scene);
+            shadeVisibilityBuffer(scene);
+        } else {
+            // The pyramid depends on draw order, so the hierarchical path stays serial
+            FragmentCounters fragments;
+            uint culled = 0;
+            Vertex vertices[3];
+            int instance = 0;
+            timer.reset();
+            timer.start();
+            // Iterate over the faces that survived culling
+            for (uint faceId : culler.visibleFaces) {
+                instance = scene.instanceOfFace(faceId, instance);
+                const SceneInstance& inst = scene.instances[instance];
+                vertexCache.gatherFace(inst, inst.model->faces[faceId - inst.faceBase], vertices);
+                // Rasterize triangle
+                if (!drawTriangle(vertices, faceId, collectStats ? &fragments : nullptr)) {
+                    culled++;
                 }
-                // Normalize Device Coordinates (NDC)
-                // Transform to Screen Space
-                // std::cout << "vertices[" << i << "].position: " << vertices[i].position << std::endl;
-                
             }
-            // Rasterize triangle
-            drawTriangle(vertices);
-            // drawTriangleWithNormal(vertices, normal); 
+            timer.stop();
+            frameStats.stageSeconds[StageScan] = timer.elapsed();
+            frameStats.trianglesOccluded = culled;
+            frameStats.trianglesRasterized = culler.visibleFaces.size() - culled;
+            frameStats.fragments = fragments;
+            std::cout << "Hierarchical rejected triangles:" << culled << "/" << culler.visibleFaces.size() << std::endl;
         }
     }
-    else if (this->zBufferMethod == ZBufferMethod::ScanLine){
+    else if (this->zBufferMethod == ZBufferMethod::OctreeHierarchical){
+        Mat4x4 viewMatrix;
+        camera.getViewMatrix(viewMatrix);
+        OctreeTraversal traversal;
+        camera.getProjectionMatrix(traversal.projectionMatrix);
+        // Faces are culled one by one as the traversal transforms them
+        culler.mode = cullMode;
+        culler.setup(camera, traversal.projectionMatrix);
+        culler.stats = CullStats();
+        culler.stats.submitted = scene.faceCount();
+        // Transform, culling and rasterization interleave here, so all of it counts as scan time
+        timer.start();
+        // Instances share their model's octree and traverse it in model space
+        for (const SceneInstance& instance : scene.instances) {
+            traversal.instance = &instance;
+            traversal.octree = &octreeFor(*instance.model);
+            traversal.viewMatrix = instance.hasTransform ? viewMatrix * instance.transform : viewMatrix;
+            if (!traversal.octree->empty()) {
+                renderOctreeNode(0, traversal);
+            }
+        }
+        timer.stop();
+        cullStats = culler.stats;
+        frameStats.stageSeconds[StageScan] = timer.elapsed();
+        frameStats.trianglesSubmitted = cullStats.submitted;
+        frameStats.trianglesBackFacing = cullStats.backFacing;
+        frameStats.trianglesOutsideFrustum = cullStats.outsideFrustum;
+        frameStats.trianglesRasterized = traversal.drawnFaces;
+        frameStats.trianglesOccluded = traversal.culledFaces - cullStats.backFacing - cullStats.outsideFrustum;
+        frameStats.fragments = traversal.fragments;
+        std::cout << "Culled back faces:" << cullStats.backFacing << " outside frustum:" << cullStats.outsideFrustum << std::endl;
+        std::cout << "Octree culled nodes:" << traversal.culledNodes
+                  << " culled triangles:" << traversal.culledFaces
+                  << " drawn triangles:" << traversal.drawnFaces << "/" << scene.faceCount() << std::endl;
+    }
+    else if (this->zBufferMethod == ZBufferMethod::ScanLine || this->zBufferMethod == ZBufferMethod::IntervalScanLine){
         ScanLineZBuffer* scanFB = dynamic_cast<ScanLineZBuffer*>(framebuffer.get());
+        Mat4x4 viewMatrix;
+        camera.getViewMatrix(viewMatrix);
+
+        Mat4x4 projectionMatrix;
+        camera.getProjectionMatrix(projectionMatrix);
+
+        Mat4x4 viewProjection = projectionMatrix * viewMatrix;
+        timer.start();
+        vertexCache.transform(scene, viewProjection, rasterThreads);
+        timer.stop();
+        frameStats.stageSeconds[StageTransform] = timer.elapsed();
+        cullFaces(scene, projectionMatrix);
+        // One table and one scan for all instances
         scanFB->clear();
-        scanFB->buildTable(model);
-        scanFB->actScan(model);
+        scanFB->countStats = collectStats;
+        scanFB->buildTable(scene, vertexCache, culler.visibleFaces);
+        scanFB->actScan();
+        frameStats.stageSeconds[StageTableBuild] = scanFB->tableBuildTime;
+        frameStats.stageSeconds[StageScan] = scanFB->scanTime;
+        frameStats.trianglesRasterized = scanFB->tableFaces;
+        if (collectStats) {
+            frameStats.scanRows = height;
+            for (const ScanBand& band : scanFB->bands) {
+                frameStats.activeEdgesTotal += band.activeEdgesTotal;
+                frameStats.activeEdgesMax = std::max(frameStats.activeEdgesMax, band.activeEdgesMax);
+                frameStats.fragments += band.fragments;
+                frameStats.pixelsCovered += band.pixelsCovered;
+            }
+        }
+        return;
+    }
+
+    frameStats.stageSeconds[StageShade] = frameStats.fragments.shadeSeconds;
+    if (collectStats) {
+        frameStats.pixelsCovered = countCoveredPixels();
+    }
+}
+
+void Renderer::cullFaces(const Scene& scene, const Mat4x4& projectionMatrix) {
+    Timer timer;
+    timer.start();
+    culler.mode = cullMode;
+    culler.setup(camera, projectionMatrix);
+    culler.run(scene, vertexCache, rasterThreads);
+    timer.stop();
+    cullStats = culler.stats;
+    frameStats.stageSeconds[StageCull] = timer.elapsed();
+    frameStats.trianglesSubmitted = cullStats.submitted;
+    frameStats.trianglesBackFacing = cullStats.backFacing;
+    frameStats.trianglesOutsideFrustum = cullStats.outsideFrustum;
+    std::cout << "Culled back faces:" << cullStats.backFacing << " outside frustum:" << cullStats.outsideFrustum
+              << " kept:" << culler.visibleFaces.size() << "/" << cullStats.submitted << std::endl;
+}
+
+const Octree& Renderer::octreeFor(const Model& model) {
+    for (ModelOctree& entry : octrees) {
+        if (entry.model == &model) {
+            // Rebuilt if the model was edited since
+            if (entry.octree.nodes.empty() || entry.octree.nodes[0].subtreeFaces != int(model.faces.size())) {
+                entry.octree.build(model);
+            }
+            return entry.octree;
+        }
+    }
+    octrees.push_back(ModelOctree{ &model, Octree() });
+    octrees.back().octree.build(model);
+    return octrees.back().octree;
+}
+
+uint64_t Renderer::countCoveredPixels() const {
+    const SimpleZbuffer* zbuffer = static_cast<const SimpleZbuffer*>(framebuffer.get());
+    uint64_t covered = 0;
+    for (int i = 0; i < width * height; i++) {
+        covered += zbuffer->depthAt(i) != -std::numeric_limits<float>::infinity();
+    }
+    return covered;
+}
+
+void Renderer::transformFace(const SceneInstance& instance, const Face& face, const Mat4x4& viewMatrix, const Mat4x4& projectionMatrix, Vertex* vertices, uint8_t* outcodes) const {
+    const Model& model = *instance.model;
+    for (int i = 0; i < 3; ++i) {
+        const Face::VertexIndices& idx = face.vertices[i];
+        vertices[i].position = model.vertices[idx.v];
+        vertices[i].worldPosition = model.vertices[idx.v];
+        vertices[i].normal = model.vNormals[idx.v];
+        vertices[i].texcoord = model.texcoords.empty() ? Vec2f() : model.texcoords[idx.vt];
+        if (instance.hasTransform) {
+            const Vec3f& p = vertices[i].worldPosition;
+            Vec4f world = instance.transform * Vec4f(p.x, p.y, p.z, 1.0f);
+            vertices[i].worldPosition = Vec3f(world.x, world.y, world.z);
+            Vec3f normal = instance.normalTransform * vertices[i].normal;
+            float length = normal.magnitude();
+            if (length > 0.0f) {
+                vertices[i].normal = normal / length;
+            }
+        }
+    }
+
+    // Transform vertices
+    for (int i = 0; i < 3; ++i) {
+        
+        Vec4f pos(vertices[i].position.x, vertices[i].position.y, vertices[i].position.z, 1.0f);
+        // World to View
+        pos = viewMatrix * pos; 
+        // View to Clip
+        pos = projectionMatrix * pos; 
+        outcodes[i] = culler.outcode(pos);
+        if (pos.w != 0.0f) {
+            vertices[i].position = Vec3f(pos.x / pos.w, pos.y / pos.w, pos.z / pos.w);
+        } else {
+            std::cerr << "Warning: pos.w is 0.0f when transforming." << std::endl;;
+        }
+        // Normalize Device Coordinates (NDC)
+        // Transform to Screen Space
+        // std::cout << "vertices[" << i << "].position: " << vertices[i].position << std::endl;
+        
+    }
+}
+
+// Sort-middle rasterization: bin the triangles that survived culling into
+// TileSize x TileSize screen tiles, then rasterize the tiles in parallel. A tile
+// only writes its own pixels, so no locking is needed, and triangles keep their
+// submission order inside each bin so the result matches a serial render.
+void Renderer::renderBinned(const Scene& scene) {
+    Timer timer;
+    timer.start();
+    int tilesX = (width + TileSize - 1) / TileSize;
+    int tilesY = (height + TileSize - 1) / TileSize;
+    tileBins.resize(tilesX * tilesY);
+    for (auto& bin : tileBins) {
+        bin.clear();
+    }
+
+    int instance = 0;
+    for (uint faceIter : culler.visibleFaces) {
+        instance = scene.instanceOfFace(faceIter, instance);
+        const SceneInstance& inst = scene.instances[instance];
+        const Face& face = inst.model->faces[faceIter - inst.faceBase];
+        float minX = std::numeric_limits<float>::max(), minY = minX;
+        float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+        for (int i = 0; i < 3; i++) {
+            uint v = inst.vertexBase + face.vertices[i].v;
+            float x = (vertexCache.x[v] + 1.0f) * 0.5f * width;
+            float y = (vertexCache.y[v] + 1.0f) * 0.5f * height;
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+        // Same pixel rect as drawTriangle; NaN coordinates fail these tests and are dropped
+        if (!(maxX >= 0.0f && maxY >= 0.0f && minX <= float(width - 1) && minY <= float(height - 1)))
+            continue;
+        int x0 = static_cast<int>(std::floor(std::max(minX, 0.0f)));
+        int y0 = static_cast<int>(std::floor(std::max(minY, 0.0f)));
+        int x1 = static_cast<int>(std::ceil(std::min(maxX, float(width - 1))));
+        int y1 = static_cast<int>(std::ceil(std::min(maxY, float(height - 1))));
+        frameStats.trianglesRasterized++;
+        for (int ty = y0 / TileSize; ty <= y1 / TileSize; ty++) {
+            for (int tx = x0 / TileSize; tx <= x1 / TileSize; tx++) {
+                tileBins[ty * tilesX + tx].push_back(faceIter);
+            }
+        }
+    }
+
+    timer.stop();
+    frameStats.stageSeconds[StageTableBuild] = timer.elapsed();
+
+    // Each tile counts its own fragments, summed once the tiles are done
+    tileFragments.assign(collectStats ? tilesX * tilesY : 0, FragmentCounters());
+    timer.reset();
+    timer.start();
+    parallelFor(tilesX * tilesY, rasterThreads, [&](int tile) {
+        FragmentCounters* counters = collectStats ? &tileFragments[tile] : nullptr;
+        int clipX0 = (tile % tilesX) * TileSize;
+        int clipY0 = (tile / tilesX) * TileSize;
+        int clipX1 = std::min(clipX0 + TileSize, width) - 1;
+        int clipY1 = std::min(clipY0 + TileSize, height) - 1;
+        Vertex vertices[3];
+        int instance = 0;
+        for (uint faceIter : tileBins[tile]) {
+            instance = scene.instanceOfFace(faceIter, instance);
+            const SceneInstance& inst = scene.instances[instance];
+            vertexCache.gatherFace(inst, inst.model->faces[faceIter - inst.faceBase], vertices);
+            drawTriangle(vertices, faceIter, clipX0, clipY0, clipX1, clipY1, counters);
+        }
+    });
+    timer.stop();
+    frameStats.stageSeconds[StageScan] = timer.elapsed();
+    for (const FragmentCounters& counters : tileFragments) {
+        frameStats.fragments += counters;
+    }
+}
+
+bool Renderer::isBoxOccluded(const BoundingBox& box, const Mat4x4& viewMatrix, const Mat4x4& projectionMatrix) const {
+    // Same screen mapping as drawTriangle. Boxes reaching the near plane cannot be
+    // projected conservatively, so they are always treated as visible.
+    float minX = std::numeric_limits<float>::max(), minY = minX;
+    float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+    float nearestZ = std::numeric_limits<float>::lowest();
+    for (int corner = 0; corner < 8; corner++) {
+        Vec4f pos(corner & 1 ? box.max.x : box.min.x,
+                  corner & 2 ? box.max.y : box.min.y,
+                  corner & 4 ? box.max.z : box.min.z, 1.0f);
+        pos = viewMatrix * pos;
+        if (pos.z > -camera.nearPlane) {
+            return false;
+        }
+        pos = projectionMatrix * pos;
+        float x = (pos.x / pos.w + 1.0f) * 0.5f * width;
+        float y = (pos.y / pos.w + 1.0f) * 0.5f * height;
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+        nearestZ = std::max(nearestZ, pos.z / pos.w);
+    }
+
+    const HierarchicalZbuffer* hzb = static_cast<const HierarchicalZbuffer*>(framebuffer.get());
+    return hzb->isOccluded(static_cast<int>(std::floor(minX)), static_cast<int>(std::floor(minY)),
+                           static_cast<int>(std::ceil(maxX)), static_cast<int>(std::ceil(maxY)), nearestZ);
+}
+
+bool Renderer::isVisible(const BoundingBox& box) const {
+    bool visible;
+    queryVisibility(&box, 1, &visible);
+    return visible;
+}
+
+int Renderer::queryVisibility(const BoundingBox* boxes, int count, bool* visible) const {
+    if (zBufferMethod != ZBufferMethod::SimpleHierarchical && zBufferMethod != ZBufferMethod::OctreeHierarchical) {
+        std::fill(visible, visible + count, true);
+        return count;
+    }
+    Mat4x4 viewMatrix;
+    camera.getViewMatrix(viewMatrix);
+    Mat4x4 projectionMatrix;
+    camera.getProjectionMatrix(projectionMatrix);
+    int visibleCount = 0;
+    for (int i = 0; i < count; i++) {
+        const BoundingBox& box = boxes[i];
+        // A box that never saw a vertex encloses nothing
+        bool empty = box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+        visible[i] = !empty && !isBoxOccluded(box, viewMatrix, projectionMatrix);
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+void Renderer::renderOctreeNode(int nodeId, OctreeTraversal& traversal) {
+    const Octree& octree = *traversal.octree;
+    const SceneInstance& instance = *traversal.instance;
+    const OctreeNode& node = octree.nodes[nodeId];
+    if (isBoxOccluded(node.box, traversal.viewMatrix, traversal.projectionMatrix)) {
+        traversal.culledNodes++;
+        traversal.culledFaces += node.subtreeFaces;
+        return;
+    }
+
+    for (int faceId : node.faces) {
+        uint8_t outcodes[3];
+        transformFace(instance, instance.model->faces[faceId], traversal.viewMatrix, traversal.projectionMatrix, traversal.vertices, outcodes);
+        const Vertex* v = traversal.vertices;
+        int culledBy = culler.classify(v[0].position, v[1].position, v[2].position, outcodes[0], outcodes[1], outcodes[2],
+                                       instance.flipsWinding);
+        if (culledBy != CullNone) {
+            if (culledBy == CullBackFaces) {
+                culler.stats.backFacing++;
+            } else {
+                culler.stats.outsideFrustum++;
+            }
+            traversal.culledFaces++;
+        } else if (drawTriangle(traversal.vertices, instance.faceBase + faceId, collectStats ? &traversal.fragments : nullptr)) {
+            traversal.drawnFaces++;
+        } else {
+            traversal.culledFaces++;
+        }
+    }
+
+    // Visit children front to back so near geometry fills the pyramid first
+    int order[8];
+    float dist[8];
+    int count = 0;
+    for (int octant = 0; octant < 8; octant++) {
+        int childId = node.children[octant];
+        if (childId < 0) {
+            continue;
+        }
+        const BoundingBox& box = octree.nodes[childId].box;
+        Vec3f center = (box.min + box.max) * 0.5f;
+        if (instance.hasTransform) {
+            Vec4f world = instance.transform * Vec4f(center.x, center.y, center.z, 1.0f);
+            center = Vec3f(world.x, world.y, world.z);
+        }
+        Vec3f d = center - camera.position;
+        float key = d.dot(d);
+        int i = count++;
+        for (; i > 0 && dist[i - 1] > key; i--) {
+            order[i] = order[i - 1];
+            dist[i] = dist[i - 1];
+        }
+        order[i] = childId;
+        dist[i] = key;
+    }
+    for (int i = 0; i < count; i++) {
+        renderOctreeNode(order[i], traversal);
     }
-    
 }
 
 void Renderer::drawTriangleWithNormal(const std::vector<Vertex> vert, Vec3f fNormal){
     return; 
 }
 
-void Renderer::drawTriangle(const std::vector<Vertex> vert) {
+bool Renderer::drawTriangle(const Vertex* vert, uint triangleId, FragmentCounters* counters) {
+    return drawTriangle(vert, triangleId, 0, 0, width - 1, height - 1, counters);
+}
+
+// Resolve pass of the visibility buffer. Barycentrics are rebuilt from the stored
+// face id with the same edge-function setup drawTriangle uses, which is redone
+// only when the id changes along a row. Rows of tiles shade in parallel.
+void Renderer::shadeVisibilityBuffer(const Scene& scene) {
+    ::VisibilityBuffer* vbuf = static_cast<::VisibilityBuffer*>(framebuffer.get());
+    Timer timer;
+    timer.start();
+    int bands = (height + TileSize - 1) / TileSize;
+    parallelFor(bands, rasterThreads, [&](int band) {
+        Vertex vertices[3];
+        uint currentId = ::VisibilityBuffer::NoTriangle;
+        int instance = 0;
+        float originX = 0.0f, originY = 0.0f;
+        float lambda1Dx = 0.0f, lambda1Dy = 0.0f, lambda2Dx = 0.0f, lambda2Dy = 0.0f;
+        // Covered pixels of a row are gathered into batches, whatever triangle they belong to.
+        // Zeroed so the unused lanes of a partial batch hold defined values, as in drawTriangle
+        FragmentBatch batch{};
+        int batchX[FragmentBatch::Size];
+        Color colors[FragmentBatch::Size];
+        int yEnd = std::min((band + 1) * TileSize, height);
+        for (int y = band * TileSize; y < yEnd; y++) {
+            const uint32_t* idRow = &vbuf->triangleIds[y * width];
+            Color* colorRow = &vbuf->colorBuffer[y * width];
+            int lanes = 0;
+            for (int x = 0; x < width; x++) {
+                uint id = idRow[x];
+                if (id == ::VisibilityBuffer::NoTriangle)
+                    continue;
+                if (id != currentId) {
+                    currentId = id;
+                    instance = scene.instanceOfFace(id, instance);
+                    const SceneInstance& inst = scene.instances[instance];
+                    vertexCache.gatherFace(inst, inst.model->faces[id - inst.faceBase], vertices);
+                    float sx[3], sy[3];
+                    for (int i = 0; i < 3; i++) {
+                        sx[i] = (vertices[i].position.x + 1.0f) * 0.5f * width;
+                        sy[i] = (vertices[i].position.y + 1.0f) * 0.5f * height;
+                    }
+                    float edge1x = sx[1] - sx[0], edge1y = sy[1] - sy[0];
+                    float edge2x = sx[2] - sx[0], edge2y = sy[2] - sy[0];
+                    // Only non-degenerate triangles were written, so denom is nonzero
+                    float invDenom = 1.0f / (edge1x * edge2y - edge2x * edge1y);
+                    originX = sx[0];
+                    originY = sy[0];
+                    lambda1Dx = edge2y * invDenom;
+                    lambda1Dy = -edge2x * invDenom;
+                    lambda2Dx = -edge1y * invDenom;
+                    lambda2Dy = edge1x * invDenom;
+                }
+                float vx = x - originX;
+                float vy = y - originY;
+                float lambda1 = lambda1Dx * vx + lambda1Dy * vy;
+                float lambda2 = lambda2Dx * vx + lambda2Dy * vy;
+                float lambda0 = 1.0f - lambda1 - lambda2;
+                batch.set(lanes, vertices[0].worldPosition * lambda0 + vertices[1].worldPosition * lambda1 + vertices[2].worldPosition * lambda2,
+                                 vertices[0].normal * lambda0 + vertices[1].normal * lambda1 + vertices[2].normal * lambda2);
+                batchX[lanes++] = x;
+                if (lanes == FragmentBatch::Size) {
+                    shader.shadeBatch(batch, (1u << lanes) - 1, colors);
+                    for (int lane = 0; lane < lanes; lane++) {
+                        colorRow[batchX[lane]] = colors[lane];
+                    }
+                    lanes = 0;
+                }
+            }
+            if (lanes) {
+                shader.shadeBatch(batch, (1u << lanes) - 1, colors);
+                for (int lane = 0; lane < lanes; lane++) {
+                    colorRow[batchX[lane]] = colors[lane];
+                }
+            }
+        }
+    });
+    timer.stop();
+    frameStats.fragments.shadeSeconds = timer.elapsed();
+}
+
+bool Renderer::drawTriangle(const Vertex* vert, uint triangleId, int clipX0, int clipY0, int clipX1, int clipY1, FragmentCounters* counters) {
     // Bounding box for the triangle
     Vertex v[3]; 
     for(int i = 0; i < 3; i++){
@@ -93,10 +644,10 @@ void Renderer::drawTriangle(const std::vector<Vertex> vert) {
     float maxY = std::max({ v[0].position.y, v[1].position.y, v[2].position.y });
 
     // Clamp to framebuffer
-    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
-    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
-    int x1 = std::min(static_cast<int>(std::ceil(maxX)), width - 1);
-    int y1 = std::min(static_cast<int>(std::ceil(maxY)), height - 1);
+    int x0 = std::max(static_cast<int>(std::floor(minX)), clipX0);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), clipY0);
+    int x1 = std::min(static_cast<int>(std::ceil(maxX)), clipX1);
+    int y1 = std::min(static_cast<int>(std::ceil(maxY)), clipY1);
 
     // Precompute area
 
@@ -109,66 +660,247 @@ void Renderer::drawTriangle(const std::vector<Vertex> vert) {
 
     const float EPSILON = 1e-6f;
     if (std::abs(denom) < EPSILON)
-        return; // Degenerate triangle
+        return false; // Degenerate triangle
 
+    HierarchicalZbuffer* hzb = nullptr;
+    if (zBufferMethod == ZBufferMethod::SimpleHierarchical || zBufferMethod == ZBufferMethod::OctreeHierarchical) {
+        hzb = static_cast<HierarchicalZbuffer*>(framebuffer.get());
+        // Nearest depth of the triangle against the farthest depth already in its bbox
+        float nearestZ = std::max({ v[0].position.z, v[1].position.z, v[2].position.z });
+        if (hzb->isOccluded(x0, y0, x1, y1, nearestZ))
+            return false;
+    }
 
-    Color RandColor(
-        static_cast<uint8_t>(rand() % 255),
-        static_cast<uint8_t>(rand() % 255),
-        static_cast<uint8_t>(rand() % 255)
-    );
-    for (int y = y0; y <= y1; ++y) {
-        for (int x = x0; x <= x1; ++x) {
-            // Sample at pixel center
-            float px = x + 0.5f;
-            float py = y + 0.5f;
-
-            float vx = x - v[0].position.x;
-            float vy = y - v[0].position.y;
+    // Barycentrics are affine in x and y, so set them up once per row from the
+    // edge functions and step them across the row without any division.
+    float invDenom = 1.0f / denom;
+    float lambda1Dx = edge2y * invDenom;
+    float lambda1Dy = -edge2x * invDenom;
+    float lambda2Dx = -edge1y * invDenom;
+    float lambda2Dy = edge1x * invDenom;
+    float z0 = v[0].position.z;
+    float dz1 = v[1].position.z - z0;
+    float dz2 = v[2].position.z - z0;
 
-            // Compute barycentric coordinates
+    // Every mode that rasterizes here keeps a SimpleZbuffer depth buffer
+    SimpleZbuffer* zbuffer = static_cast<SimpleZbuffer*>(framebuffer.get());
 
-            float lambda1 = (edge2y * vx - edge2x * vy) / denom;
-            float lambda2 = (-edge1y * vx + edge1x * vy) / denom;
-            float lambda0 = 1.0f - lambda1 - lambda2;
+    ::VisibilityBuffer* vbuf = nullptr;
+    if (zBufferMethod == ZBufferMethod::VisibilityBuffer) {
+        vbuf = static_cast<::VisibilityBuffer*>(zbuffer);
+    }
 
-            if (lambda0 < 0.0f || lambda1 < 0.0f || lambda2 < 0.0f)
-                continue;
-            
-            float zP = lambda0 * v[0].position.z + lambda1 * v[1].position.z + lambda2 * v[2].position.z;
-            // float w2 = ((v[0].position.x - v[2].position.x) * (py - v[2].position.y) -
-            //             (v[0].position.y - v[2].position.y) * (px - v[2].position.x)) / area;
+    // The bbox is walked in depth tiles. The triangle's depth range over a tile is
+    // checked against the range stored for it first: a tile the triangle is entirely
+    // behind is skipped, and one it is entirely in front of skips the per-pixel
+    // depth compare. Blocks are the 8-pixel rows of a tile.
+    const int tileSize = SimpleZbuffer::DepthTileSize;
+    static_assert(SimpleZbuffer::DepthTileSize == 8, "a depth tile row is one 8-pixel block");
+    // z is affine in screen x and y as well
+    float dzdx = lambda1Dx * dz1 + lambda2Dx * dz2;
+    float dzdy = lambda1Dy * dz1 + lambda2Dy * dz2;
+    float triangleNearest = std::max({ v[0].position.z, v[1].position.z, v[2].position.z });
+    float triangleFarthest = std::min({ v[0].position.z, v[1].position.z, v[2].position.z });
+    // Covers the rounding of the per-pixel interpolation, so the tile decisions
+    // never disagree with the per-pixel compare
+    float zSlack = 1e-6f + 1e-5f * (std::abs(dz1) + std::abs(dz2));
 
-            // If the point is inside the triangle
-            
-            // Perspective-correct interpolation
+    // With counters, blocks that passed the depth test are queued and shaded in
+    // groups, so the shade timer is read once per group rather than per block.
+    // A triangle covers each pixel once, so writing its pixels late does not
+    // change any of its own depth tests.
+    struct PendingBlock {
+        alignas(32) float l1[8];
+        alignas(32) float l2[8];
+        float z[8];
+        int x, y, count;
+        uint32_t mask;
+    };
+    const int MaxPending = 64;
+    PendingBlock pending[MaxPending];
+    int pendingTiles[MaxPending];
+    int pendingCount = 0, pendingTileCount = 0;
+    auto flushPending = [&]() {
+        if (pendingCount > 0) {
+            Color colors[MaxPending][8];
+            Timer shadeTimer;
+            shadeTimer.start();
+            for (int i = 0; i < pendingCount; i++) {
+                FragmentBatch batch;
+                batch.interpolate(vert, pending[i].l1, pending[i].l2);
+                shader.shadeBatch(batch, pending[i].mask, colors[i]);
+            }
+            counters->shadeSeconds += shadeTimer.elapsed();
+            for (int i = 0; i < pendingCount; i++) {
+                const PendingBlock& block = pending[i];
+                if (hzb) {
+                    hzb->writeSpan(block.x, block.y, block.count, block.mask, colors[i], block.z);
+                } else {
+                    zbuffer->writeSpan(block.x, block.y, block.count, block.mask, colors[i], block.z);
+                }
+            }
+        }
+        for (int i = 0; i < pendingTileCount; i++) {
+            zbuffer->refreshTileFarthest(pendingTiles[i] % zbuffer->tilesX, pendingTiles[i] / zbuffer->tilesX);
+        }
+        pendingCount = 0;
+        pendingTileCount = 0;
+    };
 
-            // Interpolate normal
-            Vec3f normal = (vert[0].normal * lambda0 + vert[1].normal * lambda1 + vert[2].normal * lambda2).normalized();
+#ifdef __AVX2__
+    const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+#endif
+    for (int ty = y0 / tileSize; ty <= y1 / tileSize; ty++) {
+        int tileY0 = std::max(ty * tileSize, y0);
+        int tileY1 = std::min(ty * tileSize + tileSize - 1, y1);
+        for (int tx = x0 / tileSize; tx <= x1 / tileSize; tx++) {
+            int x = tx * tileSize;
+            int tileX0 = std::max(x, x0);
+            int tileX1 = std::min(x + tileSize - 1, x1);
 
-            // Interpolate position in view space for shading
-            Vec3f fragPos = (vert[0].position * lambda0 + vert[1].position * lambda1 + vert[2].position * lambda2);
+            // Plane depth at the corners of the covered pixels, clamped to the vertex range
+            float zCorner = z0 + dzdx * (tileX0 - v[0].position.x) + dzdy * (tileY0 - v[0].position.y);
+            float zAcross = dzdx * (tileX1 - tileX0);
+            float zDown = dzdy * (tileY1 - tileY0);
+            float zNearest = std::min(zCorner + std::max(zAcross, 0.0f) + std::max(zDown, 0.0f), triangleNearest) + zSlack;
+            float zFarthest = std::max(zCorner + std::min(zAcross, 0.0f) + std::min(zDown, 0.0f), triangleFarthest) - zSlack;
+            const DepthTile& tile = zbuffer->depthTiles[ty * zbuffer->tilesX + tx];
+            if (zNearest <= tile.farthest)
+                continue;
+            // Only exact for float depth; quantized depths can still tie
+            bool allPass = zFarthest > tile.nearest && zbuffer->depthFormat == DepthFloat32;
 
-            // Shading
-            Vec3f color = shader.fragment(fragPos, normal, Vec2f(), camera);
+            // Lanes of the block inside both the image and the bbox
+            int count = std::min(tileSize, width - x);
+            uint32_t laneMask = ((1u << (tileX1 - x + 1)) - 1) & ~((1u << (tileX0 - x)) - 1);
+            bool wrote = false;
+            for (int y = tileY0; y <= tileY1; ++y) {
+                float vx = x0 - v[0].position.x;
+                float vy = y - v[0].position.y;
+                float lambda1Row = lambda1Dx * vx + lambda1Dy * vy;
+                float lambda2Row = lambda2Dx * vx + lambda2Dy * vy;
+                int rowStart = y * width;
 
-            // Convert color to 0-255
-            Color finalColor(
-                static_cast<uint8_t>(std::min(color.x * 255.0f, 255.0f)),
-                static_cast<uint8_t>(std::min(color.y * 255.0f, 255.0f)),
-                static_cast<uint8_t>(std::min(color.z * 255.0f, 255.0f))
-            );
+                // Coverage and depth test first, then shade only the survivors and
+                // write them as one span
+                alignas(32) float l1[8] = {}, l2[8] = {}, z[8];
+                uint32_t mask = 0;
+                uint32_t insideMask = 0;
+#ifdef __AVX2__
+                if (count == 8) {
+                    __m256 dx = _mm256_add_ps(_mm256_set1_ps(float(x - x0)), laneOffsets);
+                    __m256 lambda1 = _mm256_add_ps(_mm256_set1_ps(lambda1Row), _mm256_mul_ps(dx, _mm256_set1_ps(lambda1Dx)));
+                    __m256 lambda2 = _mm256_add_ps(_mm256_set1_ps(lambda2Row), _mm256_mul_ps(dx, _mm256_set1_ps(lambda2Dx)));
+                    __m256 lambda0 = _mm256_sub_ps(_mm256_sub_ps(one, lambda1), lambda2);
+                    __m256 inside = _mm256_and_ps(_mm256_cmp_ps(lambda0, zero, _CMP_GE_OQ),
+                                    _mm256_and_ps(_mm256_cmp_ps(lambda1, zero, _CMP_GE_OQ),
+                                                  _mm256_cmp_ps(lambda2, zero, _CMP_GE_OQ)));
+                    insideMask = _mm256_movemask_ps(inside) & laneMask;
+                    if (insideMask == 0)
+                        continue;
 
-            Color depthColor(
-                static_cast<uint8_t>(std::min(zP * 150.f, 255.0f)),
-                static_cast<uint8_t>(std::min(zP * 150.f, 255.0f)),
-                static_cast<uint8_t>(std::min(zP * 150.f, 255.0f))
-            );
+                    __m256 zP = _mm256_add_ps(_mm256_set1_ps(z0),
+                                _mm256_add_ps(_mm256_mul_ps(lambda1, _mm256_set1_ps(dz1)),
+                                              _mm256_mul_ps(lambda2, _mm256_set1_ps(dz2))));
+                    if (allPass) {
+                        mask = insideMask;
+                    } else if (zbuffer->depthFormat == DepthFloat32) {
+                        __m256 depth = _mm256_loadu_ps(zbuffer->depthBuffer.data() + rowStart + x);
+                        mask = _mm256_movemask_ps(_mm256_cmp_ps(zP, depth, _CMP_GT_OQ)) & insideMask;
+                    } else {
+                        // Same steps as SimpleZbuffer::quantizeDepth, then an integer compare
+                        __m256 t = _mm256_mul_ps(_mm256_sub_ps(zP, _mm256_set1_ps(zbuffer->depthRangeFar)),
+                                                 _mm256_set1_ps(zbuffer->depthRangeScale));
+                        t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+                        __m256i q = _mm256_add_epi32(_mm256_cvttps_epi32(_mm256_add_ps(
+                                        _mm256_mul_ps(t, _mm256_set1_ps(zbuffer->depthQuantumCount)), _mm256_set1_ps(0.5f))),
+                                        _mm256_set1_epi32(1));
+                        __m256i stored = zbuffer->depthFormat == DepthUnorm16
+                            ? _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(zbuffer->depthBuffer16.data() + rowStart + x)))
+                            : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(zbuffer->depthBuffer24.data() + rowStart + x));
+                        mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(q, stored))) & insideMask;
+                    }
+                    _mm256_store_ps(l1, lambda1);
+                    _mm256_store_ps(l2, lambda2);
+                    _mm256_store_ps(z, zP);
+                } else
+#endif
+                {
+                    for (uint32_t m = laneMask; m; m &= m - 1) {
+                        int lane = __builtin_ctz(m);
+                        float dx = float(x + lane - x0);
+                        l1[lane] = lambda1Row + dx * lambda1Dx;
+                        l2[lane] = lambda2Row + dx * lambda2Dx;
+                        float lambda0 = 1.0f - l1[lane] - l2[lane];
+                        if (lambda0 < 0.0f || l1[lane] < 0.0f || l2[lane] < 0.0f)
+                            continue;
+                        insideMask |= 1u << lane;
+                        z[lane] = z0 + (l1[lane] * dz1 + l2[lane] * dz2);
+                        bool nearer;
+                        switch (zbuffer->depthFormat) {
+                        case DepthUnorm16: nearer = zbuffer->quantizeDepth(z[lane]) > zbuffer->depthBuffer16[rowStart + x + lane]; break;
+                        case DepthUnorm24: nearer = zbuffer->quantizeDepth(z[lane]) > zbuffer->depthBuffer24[rowStart + x + lane]; break;
+                        default: nearer = z[lane] > zbuffer->depthBuffer[rowStart + x + lane]; break;
+                        }
+                        if (allPass || nearer)
+                            mask |= 1u << lane;
+                    }
+                }
+                if (counters) {
+                    counters->tested += __builtin_popcount(insideMask);
+                    counters->passed += __builtin_popcount(mask);
+                }
+                if (mask == 0)
+                    continue;
+                wrote = true;
+                // Shading is deferred to shadeVisibilityBuffer
+                if (vbuf) {
+                    vbuf->writeIdSpan(x, y, count, mask, triangleId, z);
+                    continue;
+                }
 
-            // Depth test and set pixel
-            framebuffer->setPixel(x, y, finalColor, zP);
-            
+                if (counters) {
+                    PendingBlock& block = pending[pendingCount++];
+                    std::copy(l1, l1 + 8, block.l1);
+                    std::copy(l2, l2 + 8, block.l2);
+                    std::copy(z, z + 8, block.z);
+                    block.x = x;
+                    block.y = y;
+                    block.count = count;
+                    block.mask = mask;
+                    continue;
+                }
+                Color colors[8];
+                FragmentBatch batch;
+                batch.interpolate(vert, l1, l2);
+                shader.shadeBatch(batch, mask, colors);
+                if (hzb) {
+                    hzb->writeSpan(x, y, count, mask, colors, z);
+                } else {
+                    zbuffer->writeSpan(x, y, count, mask, colors, z);
+                }
+            }
+            if (wrote) {
+                if (counters) {
+                    pendingTiles[pendingTileCount++] = ty * zbuffer->tilesX + tx;
+                } else {
+                    zbuffer->refreshTileFarthest(tx, ty);
+                }
+            }
+            // A tile queues at most one block per row
+            if (counters && (pendingCount > MaxPending - tileSize || pendingTileCount == MaxPending)) {
+                flushPending();
+            }
         }
     }
+    if (counters) {
+        flushPending();
+    }
+    if (hzb) {
+        hzb->updatePyramid();
+    }
+    return true;
 }
 
@@ -0,0 +1,91 @@
+#include "scene.h"
+#include <algorithm>
+#include <iostream>
+
+int Scene::add(const Model& model) {
+    return add(model, Mat4x4::identity());
+}
+
+int Scene::add(const Model& model, const Mat4x4& transform) {
+    SceneInstance instance;
+    instance.model = &model;
+    instance.vertexBase = vertexCount();
+    instance.faceBase = faceCount();
+    instances.push_back(instance);
+    setTransform(int(instances.size()) - 1, transform);
+    return int(instances.size()) - 1;
+}
+
+void Scene::setTransform(int index, const Mat4x4& transform) {
+    SceneInstance& instance = instances[index];
+    instance.transform = transform;
+    instance.hasTransform = transform != Mat4x4::identity();
+    instance.normalTransform = Mat3x3();
+    instance.flipsWinding = false;
+    if (!instance.hasTransform) {
+        return;
+    }
+    Mat3x3 linear;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            linear.m[i][j] = transform.m[i][j];
+    float determinant = linear.determinant();
+    instance.flipsWinding = determinant < 0.0f;
+    if (determinant == 0.0f) {
+        std::cerr << "Warning: instance " << index << " has a singular transform, normals are left unchanged." << std::endl;
+        return;
+    }
+    instance.normalTransform = linear.inverse().transpose();
+}
+
+BoundingBox Scene::bounds(int index) const {
+    const SceneInstance& instance = instances[index];
+    const BoundingBox& box = instance.model->bbox;
+    if (!instance.hasTransform) {
+        return box;
+    }
+    BoundingBox world;
+    for (int corner = 0; corner < 8; corner++) {
+        Vec4f pos = instance.transform * Vec4f(corner & 1 ? box.max.x : box.min.x,
+                                               corner & 2 ? box.max.y : box.min.y,
+                                               corner & 4 ? box.max.z : box.min.z, 1.0f);
+        world.update(Vec3f(pos.x, pos.y, pos.z));
+    }
+    return world;
+}
+
+uint Scene::vertexCount() const {
+    if (instances.empty()) {
+        return 0;
+    }
+    const SceneInstance& last = instances.back();
+    return last.vertexBase + last.model->vertices.size();
+}
+
+uint Scene::faceCount() const {
+    if (instances.empty()) {
+        return 0;
+    }
+    const SceneInstance& last = instances.back();
+    return last.faceBase + last.model->faces.size();
+}
+
+int Scene::instanceOfVertex(uint vertex, int hint) const {
+    const SceneInstance& guess = instances[hint];
+    if (vertex >= guess.vertexBase && vertex < guess.vertexBase + guess.model->vertices.size()) {
+        return hint;
+    }
+    auto it = std::upper_bound(instances.begin(), instances.end(), vertex,
+                               [](uint v, const SceneInstance& instance) { return v < instance.vertexBase; });
+    return int(it - instances.begin()) - 1;
+}
+
+int Scene::instanceOfFace(uint face, int hint) const {
+    const SceneInstance& guess = instances[hint];
+    if (face >= guess.faceBase && face < guess.faceBase + guess.model->faces.size()) {
+        return hint;
+    }
+    auto it = std::upper_bound(instances.begin(), instances.end(), face,
+                               [](uint f, const SceneInstance& instance) { return f < instance.faceBase; });
+    return int(it - instances.begin()) - 1;
+}
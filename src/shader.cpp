@@ -1,43 +1,206 @@
 #include "shader.h"
+#include <algorithm>
 #include <cmath>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 Shader::Shader()
     : light(),
       ambientColor(0.1f, 0.1f, 0.1f),
       diffuseColor(0.5f, 0.5f, 0.5f),
       specularColor(1.0f, 1.0f, 1.0f),
-      shininess(32.0f) {}
+      shininess(32.0f) {
+    prepare(Camera());
+}
 
 Shader::Shader(const Light& l, const Vec3f& ambient, const Vec3f& diffuse, const Vec3f& specular, float shin)
     : light(l),
       ambientColor(ambient),
       diffuseColor(diffuse),
       specularColor(specular),
-      shininess(shin) {}
+      shininess(shin) {
+    prepare(Camera());
+}
+
+// One entry per combination of ShadingFeature flags
+static const int VariantCount = ShadeAll + 1;
 
 Vec3f Shader::fragment(const Vec3f& fragPos, const Vec3f& normal, const Vec2f& texcoord, const Camera& camera) const {
+    return shadeVariantFor(features)(makeUniforms(camera), fragPos, normal);
+}
+
+void Shader::prepare(const Camera& camera) {
+    static const BatchFn batchVariants[VariantCount] = {
+        shadeBatchVariant<0>, shadeBatchVariant<1>, shadeBatchVariant<2>, shadeBatchVariant<3>,
+        shadeBatchVariant<4>, shadeBatchVariant<5>, shadeBatchVariant<6>, shadeBatchVariant<7>
+    };
+    uniforms = makeUniforms(camera);
+    shadeFn = shadeVariantFor(features);
+    batchFn = batchVariants[features & ShadeAll];
+}
+
+Shader::ShadeFn Shader::shadeVariantFor(int features) {
+    static const ShadeFn variants[VariantCount] = {
+        shadeVariant<0>, shadeVariant<1>, shadeVariant<2>, shadeVariant<3>,
+        shadeVariant<4>, shadeVariant<5>, shadeVariant<6>, shadeVariant<7>
+    };
+    return variants[features & ShadeAll];
+}
+
+Shader::Uniforms Shader::makeUniforms(const Camera& camera) const {
+    Uniforms u;
+    u.lightDir = (-light.direction).normalized();
+    u.eye = camera.position;
+    u.ambient = ambientColor;
+    u.diffuse = diffuseColor;
+    u.specular = specularColor;
+    u.shininess = shininess;
+    return u;
+}
+
+template <int Features>
+Vec3f Shader::shadeVariant(const Uniforms& u, const Vec3f& fragPos, const Vec3f& normal) {
+    Vec3f result(0.0f, 0.0f, 0.0f);
     // Ambient
-    Vec3f ambient = ambientColor;
+    if (Features & ShadeAmbient) {
+        result += u.ambient;
+    }
 
     // Diffuse
-    Vec3f lightDir = (-light.direction).normalized();
-    float diff = std::max(normal.dot(lightDir), 0.0f);
-    Vec3f diffuse = diffuseColor * diff;
+    float nDotL = normal.dot(u.lightDir);
+    if (Features & ShadeDiffuse) {
+        result += u.diffuse * std::max(nDotL, 0.0f);
+    }
 
     // Specular
-    Vec3f viewDir = (camera.position - fragPos).normalized();
-    Vec3f reflectDir = (2.0f * normal.dot(lightDir) * normal - lightDir).normalized();
-    float spec = std::pow(std::max(viewDir.dot(reflectDir), 0.0f), shininess);
-    Vec3f specular = specularColor * spec;
+    if (Features & ShadeSpecular) {
+        Vec3f viewDir = (u.eye - fragPos).normalized();
+        Vec3f reflectDir = (2.0f * nDotL * normal - u.lightDir).normalized();
+        float spec = std::pow(std::max(viewDir.dot(reflectDir), 0.0f), u.shininess);
+        result += u.specular * spec;
+    }
 
-    // Combine results
-    Vec3f result = ambient + diffuse;
     // Clamp the result
     result.x = std::min(result.x, 1.0f);
     result.y = std::min(result.y, 1.0f);
     result.z = std::min(result.z, 1.0f);
-
-    // return random color to debug fragment
-    // return Vec3f(rand() % 255 / 255.0f, rand() % 255 / 255.0f, rand() % 255 / 255.0f);
     return result;
 }
+
+#ifdef __AVX2__
+namespace {
+
+inline __m256 dot3(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz) {
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz));
+}
+
+// Divides by the length, as Vec3f::normalized() does
+inline void normalize3(__m256& x, __m256& y, __m256& z) {
+    __m256 length = _mm256_sqrt_ps(dot3(x, y, z, x, y, z));
+    x = _mm256_div_ps(x, length);
+    y = _mm256_div_ps(y, length);
+    z = _mm256_div_ps(z, length);
+}
+
+} // namespace
+#endif
+
+template <int Features>
+void Shader::shadeBatchVariant(const Uniforms& u, const FragmentBatch& batch, uint32_t mask, Color* out) {
+#ifdef __AVX2__
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 nx = _mm256_load_ps(batch.nx);
+    __m256 ny = _mm256_load_ps(batch.ny);
+    __m256 nz = _mm256_load_ps(batch.nz);
+    normalize3(nx, ny, nz);
+    __m256 lx = _mm256_set1_ps(u.lightDir.x);
+    __m256 ly = _mm256_set1_ps(u.lightDir.y);
+    __m256 lz = _mm256_set1_ps(u.lightDir.z);
+
+    __m256 r = zero, g = zero, b = zero;
+    if (Features & ShadeAmbient) {
+        r = _mm256_add_ps(r, _mm256_set1_ps(u.ambient.x));
+        g = _mm256_add_ps(g, _mm256_set1_ps(u.ambient.y));
+        b = _mm256_add_ps(b, _mm256_set1_ps(u.ambient.z));
+    }
+
+    __m256 nDotL = dot3(nx, ny, nz, lx, ly, lz);
+    if (Features & ShadeDiffuse) {
+        __m256 diff = _mm256_max_ps(nDotL, zero);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(u.diffuse.x), diff));
+        g = _mm256_add_ps(g, _mm256_mul_ps(_mm256_set1_ps(u.diffuse.y), diff));
+        b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_set1_ps(u.diffuse.z), diff));
+    }
+
+    if (Features & ShadeSpecular) {
+        __m256 vx = _mm256_sub_ps(_mm256_set1_ps(u.eye.x), _mm256_load_ps(batch.px));
+        __m256 vy = _mm256_sub_ps(_mm256_set1_ps(u.eye.y), _mm256_load_ps(batch.py));
+        __m256 vz = _mm256_sub_ps(_mm256_set1_ps(u.eye.z), _mm256_load_ps(batch.pz));
+        normalize3(vx, vy, vz);
+        __m256 twoNDotL = _mm256_mul_ps(_mm256_set1_ps(2.0f), nDotL);
+        __m256 rx = _mm256_sub_ps(_mm256_mul_ps(twoNDotL, nx), lx);
+        __m256 ry = _mm256_sub_ps(_mm256_mul_ps(twoNDotL, ny), ly);
+        __m256 rz = _mm256_sub_ps(_mm256_mul_ps(twoNDotL, nz), lz);
+        normalize3(rx, ry, rz);
+        // No vector pow; the exponent is applied per lane
+        alignas(32) float spec[FragmentBatch::Size];
+        _mm256_store_ps(spec, _mm256_max_ps(dot3(vx, vy, vz, rx, ry, rz), zero));
+        for (int lane = 0; lane < FragmentBatch::Size; lane++) {
+            spec[lane] = (mask >> lane) & 1 ? std::pow(spec[lane], u.shininess) : 0.0f;
+        }
+        __m256 s = _mm256_load_ps(spec);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(u.specular.x), s));
+        g = _mm256_add_ps(g, _mm256_mul_ps(_mm256_set1_ps(u.specular.y), s));
+        b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_set1_ps(u.specular.z), s));
+    }
+
+    // Clamp, then convert to 0-255 with the same truncation as the scalar path
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    alignas(32) int32_t ri[FragmentBatch::Size], gi[FragmentBatch::Size], bi[FragmentBatch::Size];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(ri), _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(_mm256_min_ps(r, one), scale), scale)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(gi), _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(_mm256_min_ps(g, one), scale), scale)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(bi), _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(_mm256_min_ps(b, one), scale), scale)));
+    for (; mask; mask &= mask - 1) {
+        int lane = __builtin_ctz(mask);
+        out[lane] = Color(uint8_t(ri[lane]), uint8_t(gi[lane]), uint8_t(bi[lane]));
+    }
+#else
+    for (; mask; mask &= mask - 1) {
+        int lane = __builtin_ctz(mask);
+        Vec3f normal = Vec3f(batch.nx[lane], batch.ny[lane], batch.nz[lane]).normalized();
+        Vec3f color = shadeVariant<Features>(u, Vec3f(batch.px[lane], batch.py[lane], batch.pz[lane]), normal);
+        out[lane] = Color(
+            static_cast<uint8_t>(std::min(color.x * 255.0f, 255.0f)),
+            static_cast<uint8_t>(std::min(color.y * 255.0f, 255.0f)),
+            static_cast<uint8_t>(std::min(color.z * 255.0f, 255.0f))
+        );
+    }
+#endif
+}
+
+void FragmentBatch::interpolate(const Vertex* vert, const float* lambda1, const float* lambda2) {
+#ifdef __AVX2__
+    __m256 l1 = _mm256_loadu_ps(lambda1);
+    __m256 l2 = _mm256_loadu_ps(lambda2);
+    __m256 l0 = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), l1), l2);
+    // Same operation order as the Vec3f expression in the scalar path
+    auto lerp = [&](float a, float b, float c) {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a), l0), _mm256_mul_ps(_mm256_set1_ps(b), l1)),
+                             _mm256_mul_ps(_mm256_set1_ps(c), l2));
+    };
+    _mm256_store_ps(px, lerp(vert[0].worldPosition.x, vert[1].worldPosition.x, vert[2].worldPosition.x));
+    _mm256_store_ps(py, lerp(vert[0].worldPosition.y, vert[1].worldPosition.y, vert[2].worldPosition.y));
+    _mm256_store_ps(pz, lerp(vert[0].worldPosition.z, vert[1].worldPosition.z, vert[2].worldPosition.z));
+    _mm256_store_ps(nx, lerp(vert[0].normal.x, vert[1].normal.x, vert[2].normal.x));
+    _mm256_store_ps(ny, lerp(vert[0].normal.y, vert[1].normal.y, vert[2].normal.y));
+    _mm256_store_ps(nz, lerp(vert[0].normal.z, vert[1].normal.z, vert[2].normal.z));
+#else
+    for (int lane = 0; lane < Size; lane++) {
+        float lambda0 = 1.0f - lambda1[lane] - lambda2[lane];
+        set(lane, vert[0].worldPosition * lambda0 + vert[1].worldPosition * lambda1[lane] + vert[2].worldPosition * lambda2[lane],
+                  vert[0].normal * lambda0 + vert[1].normal * lambda1[lane] + vert[2].normal * lambda2[lane]);
+    }
+#endif
+}
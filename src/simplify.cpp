@@ -0,0 +1,358 @@
+#include "simplify.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <queue>
+#include <vector>
+
+namespace {
+
+// Symmetric 4x4 matrix summing squared distances to planes, upper triangle only
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0;
+    double yy = 0, yz = 0, yw = 0;
+    double zz = 0, zw = 0;
+    double ww = 0;
+
+    // Plane a*x + b*y + c*z + d = 0 with (a, b, c) of unit length
+    void addPlane(double a, double b, double c, double d, double weight) {
+        xx += weight * a * a; xy += weight * a * b; xz += weight * a * c; xw += weight * a * d;
+        yy += weight * b * b; yz += weight * b * c; yw += weight * b * d;
+        zz += weight * c * c; zw += weight * c * d;
+        ww += weight * d * d;
+    }
+    Quadric& operator+=(const Quadric& q) {
+        xx += q.xx; xy += q.xy; xz += q.xz; xw += q.xw;
+        yy += q.yy; yz += q.yz; yw += q.yw;
+        zz += q.zz; zw += q.zw;
+        ww += q.ww;
+        return *this;
+    }
+    double error(const Vec3f& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return x * (xx * x + 2 * (xy * y + xz * z + xw)) + y * (yy * y + 2 * (yz * z + yw)) + z * (zz * z + 2 * zw) + ww;
+    }
+    // Point of least error, if the 3x3 part is well conditioned
+    bool minimum(Vec3f& p) const {
+        double det = xx * (yy * zz - yz * yz) - xy * (xy * zz - yz * xz) + xz * (xy * yz - yy * xz);
+        double scale = xx * yy * zz;
+        if (std::fabs(det) <= 1e-10 * std::fabs(scale) || det == 0.0) {
+            return false;
+        }
+        // Cramer's rule on A p = -b
+        double bx = -xw, by = -yw, bz = -zw;
+        double x = (bx * (yy * zz - yz * yz) - xy * (by * zz - yz * bz) + xz * (by * yz - yy * bz)) / det;
+        double y = (xx * (by * zz - bz * yz) - bx * (xy * zz - yz * xz) + xz * (xy * bz - by * xz)) / det;
+        double z = (xx * (yy * bz - yz * by) - xy * (xy * bz - by * xz) + bx * (xy * yz - yy * xz)) / det;
+        p = Vec3f(float(x), float(y), float(z));
+        return true;
+    }
+};
+
+struct Collapse {
+    double cost;
+    int v0, v1;                 // v1 is merged into v0
+    uint32_t version0, version1; // vertex versions the collapse was computed for
+    Vec3f target;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+// Boundary planes are weighted up so open borders keep their shape
+const double BoundaryWeight = 100.0;
+
+class Simplifier {
+public:
+    explicit Simplifier(const Model& source);
+    void run(int targetFaces);
+    Model result() const;
+
+private:
+    const Model& source;
+    std::vector<Vec3f> positions;
+    std::vector<Vec3f> normalSums;
+    std::vector<int> texcoordIndex;          // per vertex, from the first corner using it
+    std::vector<std::array<int, 3>> triangles;
+    std::vector<bool> faceAlive;
+    std::vector<std::vector<int>> vertexFaces; // live faces around each vertex
+    std::vector<Quadric> quadrics;
+    std::vector<uint32_t> versions;          // bumped whenever a vertex moves or merges
+    std::vector<bool> vertexRemoved;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    int liveFaces = 0;
+
+    // Scratch for the neighbor checks
+    std::vector<int> neighbors0, neighbors1;
+
+    void pushCollapse(int v0, int v1);
+    void gatherNeighbors(int v, std::vector<int>& out) const;
+    bool isCollapseValid(const Collapse& c);
+    void applyCollapse(const Collapse& c);
+};
+
+Simplifier::Simplifier(const Model& src) : source(src) {
+    int vertexCount = source.vertices.size();
+    int faceCount = source.faces.size();
+    positions.assign(source.vertices.begin(), source.vertices.end());
+    if (source.vNormals.size() == source.vertices.size()) {
+        normalSums.assign(source.vNormals.begin(), source.vNormals.end());
+    } else {
+        normalSums.assign(vertexCount, Vec3f(0.0f, 0.0f, 0.0f));
+    }
+    texcoordIndex.assign(vertexCount, -1);
+    triangles.resize(faceCount);
+    faceAlive.assign(faceCount, true);
+    vertexFaces.resize(vertexCount);
+    quadrics.resize(vertexCount);
+    versions.assign(vertexCount, 0);
+    vertexRemoved.assign(vertexCount, false);
+
+    // Face planes, weighted by area
+    std::vector<std::pair<uint64_t, int>> edges; // (vertex pair, face)
+    edges.reserve(3 * faceCount);
+    for (int f = 0; f < faceCount; f++) {
+        const Face& face = source.faces[f];
+        for (int k = 0; k < 3; k++) {
+            int v = face.vertices[k].v;
+            triangles[f][k] = v;
+            if (texcoordIndex[v] < 0) {
+                texcoordIndex[v] = face.vertices[k].vt;
+            }
+        }
+        const std::array<int, 3>& t = triangles[f];
+        if (t[0] == t[1] || t[1] == t[2] || t[0] == t[2]) {
+            faceAlive[f] = false;
+            continue;
+        }
+        liveFaces++;
+        for (int k = 0; k < 3; k++) {
+            vertexFaces[t[k]].push_back(f);
+            uint32_t a = t[k], b = t[(k + 1) % 3];
+            edges.push_back({ (uint64_t(std::min(a, b)) << 32) | std::max(a, b), f });
+        }
+        Vec3f normal = (positions[t[1]] - positions[t[0]]).cross(positions[t[2]] - positions[t[0]]);
+        float length = normal.magnitude();
+        if (length == 0.0f) {
+            continue;
+        }
+        Vec3f n = normal / length;
+        Quadric q;
+        q.addPlane(n.x, n.y, n.z, -double(n.dot(positions[t[0]])), 0.5 * length);
+        for (int k = 0; k < 3; k++) {
+            quadrics[t[k]] += q;
+        }
+    }
+
+    // An edge used by a single face is on the border: add a plane through it,
+    // perpendicular to the face
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j].first == edges[i].first) {
+            j++;
+        }
+        int a = int(edges[i].first >> 32), b = int(edges[i].first & 0xFFFFFFFFu);
+        if (j - i == 1) {
+            const std::array<int, 3>& t = triangles[edges[i].second];
+            Vec3f faceNormal = (positions[t[1]] - positions[t[0]]).cross(positions[t[2]] - positions[t[0]]);
+            Vec3f edge = positions[b] - positions[a];
+            Vec3f n = edge.cross(faceNormal);
+            float length = n.magnitude();
+            if (length > 0.0f) {
+                n = n / length;
+                Quadric q;
+                q.addPlane(n.x, n.y, n.z, -double(n.dot(positions[a])), BoundaryWeight * edge.dot(edge));
+                quadrics[a] += q;
+                quadrics[b] += q;
+            }
+        }
+        i = j;
+    }
+    for (size_t i = 0; i < edges.size(); i++) {
+        if (i == 0 || edges[i].first != edges[i - 1].first) {
+            pushCollapse(int(edges[i].first >> 32), int(edges[i].first & 0xFFFFFFFFu));
+        }
+    }
+}
+
+void Simplifier::pushCollapse(int v0, int v1) {
+    Quadric q = quadrics[v0];
+    q += quadrics[v1];
+    Collapse c;
+    c.v0 = v0;
+    c.v1 = v1;
+    c.version0 = versions[v0];
+    c.version1 = versions[v1];
+    if (!q.minimum(c.target)) {
+        // Singular: the best of the endpoints and the midpoint
+        Vec3f options[3] = { positions[v0], positions[v1], (positions[v0] + positions[v1]) * 0.5f };
+        c.target = options[0];
+        for (int i = 1; i < 3; i++) {
+            if (q.error(options[i]) < q.error(c.target)) {
+                c.target = options[i];
+            }
+        }
+    }
+    c.cost = std::max(q.error(c.target), 0.0);
+    queue.push(c);
+}
+
+void Simplifier::gatherNeighbors(int v, std::vector<int>& out) const {
+    out.clear();
+    for (int f : vertexFaces[v]) {
+        for (int u : triangles[f]) {
+            if (u != v) {
+                out.push_back(u);
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+bool Simplifier::isCollapseValid(const Collapse& c) {
+    // The vertices shared by both neighborhoods must be exactly the third corners
+    // of the faces on the edge, or the collapse pinches the surface
+    gatherNeighbors(c.v0, neighbors0);
+    gatherNeighbors(c.v1, neighbors1);
+    int common = 0;
+    for (size_t i = 0, j = 0; i < neighbors0.size() && j < neighbors1.size(); ) {
+        if (neighbors0[i] < neighbors1[j]) {
+            i++;
+        } else if (neighbors1[j] < neighbors0[i]) {
+            j++;
+        } else {
+            common++;
+            i++;
+            j++;
+        }
+    }
+    int shared = 0;
+    for (int f : vertexFaces[c.v0]) {
+        const std::array<int, 3>& t = triangles[f];
+        shared += t[0] == c.v1 || t[1] == c.v1 || t[2] == c.v1;
+    }
+    if (shared == 0 || common != shared) {
+        return false;
+    }
+
+    // No remaining face may turn over or collapse to a line
+    for (int v : { c.v0, c.v1 }) {
+        for (int f : vertexFaces[v]) {
+            const std::array<int, 3>& t = triangles[f];
+            bool onEdge = (t[0] == c.v0 || t[1] == c.v0 || t[2] == c.v0) && (t[0] == c.v1 || t[1] == c.v1 || t[2] == c.v1);
+            if (onEdge) {
+                continue;
+            }
+            Vec3f before[3], after[3];
+            for (int k = 0; k < 3; k++) {
+                before[k] = positions[t[k]];
+                after[k] = t[k] == v ? c.target : before[k];
+            }
+            Vec3f oldNormal = (before[1] - before[0]).cross(before[2] - before[0]);
+            Vec3f newNormal = (after[1] - after[0]).cross(after[2] - after[0]);
+            if (newNormal.dot(oldNormal) <= 0.0f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Simplifier::applyCollapse(const Collapse& c) {
+    int v0 = c.v0, v1 = c.v1;
+    positions[v0] = c.target;
+    quadrics[v0] += quadrics[v1];
+    normalSums[v0] += normalSums[v1];
+    versions[v0]++;
+    vertexRemoved[v1] = true;
+
+    for (int f : vertexFaces[v1]) {
+        std::array<int, 3>& t = triangles[f];
+        if (t[0] == v0 || t[1] == v0 || t[2] == v0) {
+            faceAlive[f] = false;
+            liveFaces--;
+            for (int w : t) {
+                if (w != v1) {
+                    std::vector<int>& faces = vertexFaces[w];
+                    faces.erase(std::find(faces.begin(), faces.end(), f));
+                }
+            }
+            continue;
+        }
+        for (int& v : t) {
+            if (v == v1) {
+                v = v0;
+            }
+        }
+        vertexFaces[v0].push_back(f);
+    }
+    vertexFaces[v1].clear();
+    gatherNeighbors(v0, neighbors0);
+    for (int u : neighbors0) {
+        pushCollapse(v0, u);
+    }
+}
+
+void Simplifier::run(int targetFaces) {
+    while (liveFaces > targetFaces && !queue.empty()) {
+        Collapse c = queue.top();
+        queue.pop();
+        if (vertexRemoved[c.v0] || vertexRemoved[c.v1]
+            || versions[c.v0] != c.version0 || versions[c.v1] != c.version1) {
+            continue; // stale
+        }
+        if (isCollapseValid(c)) {
+            applyCollapse(c);
+        }
+    }
+}
+
+Model Simplifier::result() const {
+    Model lod;
+    bool hasNormals = source.vNormals.size() == source.vertices.size();
+    bool hasTexcoords = !source.texcoords.empty();
+    std::vector<int> remap(positions.size(), -1);
+    for (size_t f = 0; f < triangles.size(); f++) {
+        if (!faceAlive[f]) {
+            continue;
+        }
+        Face face;
+        for (int k = 0; k < 3; k++) {
+            int v = triangles[f][k];
+            if (remap[v] < 0) {
+                remap[v] = lod.vertices.size();
+                lod.vertices.push_back(positions[v]);
+                if (hasNormals) {
+                    float length = normalSums[v].magnitude();
+                    lod.vNormals.push_back(length > 0.0f ? normalSums[v] / length : Vec3f(0.0f, 1.0f, 0.0f));
+                }
+                if (hasTexcoords) {
+                    lod.texcoords.push_back(source.texcoords[texcoordIndex[v]]);
+                }
+            }
+            face.vertices[k] = { remap[v], hasTexcoords ? remap[v] : 0, 0 };
+        }
+        lod.faces.push_back(face);
+        const Face& added = lod.faces.back();
+        const Vec3f& p0 = lod.vertices[added.vertices[0].v];
+        lod.fNormals.push_back((lod.vertices[added.vertices[1].v] - p0).cross(lod.vertices[added.vertices[2].v] - p0));
+    }
+    if (!hasNormals) {
+        lod.computeNormals();
+    }
+    if (!lod.vertices.empty()) {
+        lod.computeBoundingBox();
+    }
+    return lod;
+}
+
+} // namespace
+
+Model simplifyModel(const Model& source, int targetFaces) {
+    Simplifier simplifier(source);
+    simplifier.run(targetFaces);
+    return simplifier.result();
+}